@@ -0,0 +1,136 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory_resource>
+
+#include "ack_table.hpp"
+#include "tracked_resource.hpp"
+
+/**
+ * @brief URB ack bookkeeping with 1024 messages in flight and 10, 64 and
+ * 256 processes. Every process acks every message, in a random order, and
+ * the acks are counted after each one like the majority check does. The
+ * messages are erased once fully acked, and the next 1024 take their
+ * place. Once with AckTable and once with the map of sets it replaced,
+ * both on a heap and on a pooled TrackedResource.
+ *
+ */
+
+typedef std::chrono::steady_clock Clock;
+typedef AckTable::Key Key;
+typedef AckTable::Process Process;
+
+static constexpr std::size_t kInFlight = 1024;
+static constexpr std::size_t kAcks = 4000000;
+static constexpr int kRepeats = 3;
+
+/**
+ * @brief What acks_ was before AckTable
+ *
+ */
+class SetTable
+{
+private:
+  std::pmr::unordered_map<Key, std::pmr::unordered_set<Process>> rows_;
+
+public:
+  explicit SetTable(std::pmr::memory_resource *resource) : rows_(resource) {}
+
+  inline void Reserve(Process) {}
+
+  inline std::size_t Ack(const Key &key, Process process)
+  {
+    auto &row = rows_[key];
+    row.insert(process);
+    return row.size();
+  }
+
+  inline void Erase(const Key &key)
+  {
+    rows_.erase(key);
+  }
+};
+
+struct Result
+{
+  double ns_per_ack;
+  double bytes_per_msg;
+  std::size_t majorities;
+};
+
+template <typename Table>
+static Result Run(Process n, bool pooled, const std::vector<std::pair<std::uint32_t, Process>> &order)
+{
+  TrackedResource resource(pooled);
+  Table table(&resource);
+  table.Reserve(n);
+
+  const std::size_t rounds = kAcks / order.size() + 1;
+  const std::size_t majority = n / 2 + 1;
+  std::size_t majorities = 0;
+
+  const auto t0 = Clock::now();
+  for (std::size_t round = 0; round < rounds; round++)
+  {
+    const auto first = static_cast<Key::Seq>(1 + round * kInFlight);
+    for (const auto &[msg, process] : order)
+    {
+      majorities += table.Ack({first + msg, 1}, process) == majority;
+    }
+    for (std::uint32_t msg = 0; msg < kInFlight; msg++)
+    {
+      table.Erase({first + msg, 1});
+    }
+  }
+  const auto t1 = Clock::now();
+
+  const auto acks = static_cast<double>(rounds * order.size());
+  return {std::chrono::duration<double, std::nano>(t1 - t0).count() / acks,
+          static_cast<double>(resource.stats().peak_bytes) / kInFlight,
+          majorities};
+}
+
+int main()
+{
+  bool ok = true;
+
+  for (const Process n : {Process{10}, Process{64}, Process{256}})
+  {
+    std::vector<std::pair<std::uint32_t, Process>> order;
+    order.reserve(kInFlight * n);
+    for (std::uint32_t msg = 0; msg < kInFlight; msg++)
+    {
+      for (Process process = 1; process <= n; process++)
+      {
+        order.emplace_back(msg, process);
+      }
+    }
+    std::mt19937 rng(n);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    for (const bool pooled : {false, true})
+    {
+      Result sets{1e9, 0, 0};
+      Result table{1e9, 0, 0};
+
+      for (int repeat = 0; repeat < kRepeats; repeat++)
+      {
+        auto result = Run<SetTable>(n, pooled, order);
+        sets = result.ns_per_ack < sets.ns_per_ack ? result : sets;
+        result = Run<AckTable>(n, pooled, order);
+        table = result.ns_per_ack < table.ns_per_ack ? result : table;
+      }
+
+      std::printf("n=%3u %-4s  map of sets %5.1f ns/ack %6.0f B/msg  AckTable %5.1f ns/ack %4.0f B/msg\n",
+                  n, pooled ? "pool" : "heap", sets.ns_per_ack, sets.bytes_per_msg, table.ns_per_ack, table.bytes_per_msg);
+      ok = ok && sets.majorities == table.majorities;
+    }
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <memory_resource>
+
+#include "reorder_window.hpp"
+
+/**
+ * @brief URB's delivered set for 4M seqs of one author, shuffled within
+ * consecutive blocks of k. Each message arrives 1 to 4 times, the copies
+ * a little after the first one. Every copy is checked with Contains, the
+ * first one is inserted, and a seq a little below is checked too like
+ * the delivery checks do. Once with a ReorderWindow and once with the
+ * watermark and std::set PeerState it replaced, with the same answers.
+ *
+ */
+
+typedef std::chrono::steady_clock Clock;
+typedef ReorderWindow::Seq Seq;
+
+static constexpr Seq kSeqs = 4000000;
+static constexpr std::size_t kWindow = 4096;
+static constexpr int kRepeats = 3;
+
+/**
+ * @brief What DeliveredSet kept per author before the window
+ *
+ */
+class SetDelivered
+{
+private:
+  Seq watermark_{1}; // Every seq below it was delivered
+  std::pmr::set<Seq> delivered_;
+
+public:
+  explicit SetDelivered(std::pmr::memory_resource *resource) : delivered_(resource) {}
+
+  inline bool Contains(Seq seq) const
+  {
+    return seq < watermark_ || delivered_.count(seq) > 0;
+  }
+
+  void Insert(Seq seq)
+  {
+    if (seq != watermark_)
+    {
+      delivered_.insert(seq);
+      return;
+    }
+
+    watermark_++;
+
+    std::vector<Seq> to_remove;
+    to_remove.reserve(delivered_.size());
+    for (const auto delivered : delivered_)
+    {
+      if (delivered != watermark_)
+      {
+        break;
+      }
+
+      to_remove.emplace_back(delivered);
+      watermark_++;
+    }
+
+    for (const auto delivered : to_remove)
+    {
+      delivered_.erase(delivered);
+    }
+  }
+};
+
+class WindowDelivered
+{
+private:
+  ReorderWindow window_;
+
+public:
+  explicit WindowDelivered(std::pmr::memory_resource *resource) : window_(kWindow, resource) {}
+
+  inline bool Contains(Seq seq) const
+  {
+    return window_.Contains(seq);
+  }
+
+  inline void Insert(Seq seq)
+  {
+    window_.Insert(seq);
+  }
+};
+
+static std::vector<Seq> MakeCopies(Seq block)
+{
+  std::mt19937 rng(block);
+  std::vector<Seq> order(kSeqs);
+  for (Seq i = 0; i < kSeqs; i++)
+  {
+    order[i] = i + 1;
+  }
+  for (Seq i = 0; i < kSeqs; i += block)
+  {
+    std::shuffle(order.begin() + i, order.begin() + std::min(kSeqs, i + block), rng);
+  }
+
+  std::vector<Seq> copies;
+  copies.reserve(std::size_t{kSeqs} * 5 / 2);
+  for (Seq i = 0; i < kSeqs; i++)
+  {
+    copies.push_back(order[i]);
+    for (auto extra = rng() % 4; extra > 0; extra--)
+    {
+      copies.push_back(order[i > 32 ? i - rng() % 32 : i]);
+    }
+  }
+
+  return copies;
+}
+
+template <typename Delivered>
+static double Run(const std::vector<Seq> &copies, std::size_t &hits)
+{
+  std::pmr::unsynchronized_pool_resource pool;
+  Delivered delivered(&pool);
+
+  hits = 0;
+  const auto t0 = Clock::now();
+  for (const auto seq : copies)
+  {
+    if (delivered.Contains(seq))
+    {
+      hits++;
+    }
+    else
+    {
+      delivered.Insert(seq);
+    }
+    hits += delivered.Contains(seq > 8 ? seq - 8 : seq);
+  }
+  const auto t1 = Clock::now();
+
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(copies.size());
+}
+
+int main()
+{
+  bool ok = true;
+
+  for (const Seq block : {Seq{1}, Seq{16}, Seq{256}, Seq{4096}, Seq{65536}})
+  {
+    const auto copies = MakeCopies(block);
+    double set_ns = 1e9;
+    double window_ns = 1e9;
+    std::size_t set_hits = 0;
+    std::size_t window_hits = 0;
+
+    for (int repeat = 0; repeat < kRepeats; repeat++)
+    {
+      set_ns = std::min(set_ns, Run<SetDelivered>(copies, set_hits));
+      window_ns = std::min(window_ns, Run<WindowDelivered>(copies, window_hits));
+    }
+
+    std::printf("block %5u  std::set %6.1f ns/copy  ReorderWindow %6.1f ns/copy  %s\n",
+                block, set_ns, window_ns, set_hits == window_hits ? "same answers" : "MISMATCH");
+    ok = ok && set_hits == window_hits;
+  }
+
+  return ok ? 0 : 1;
+}
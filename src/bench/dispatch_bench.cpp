@@ -0,0 +1,135 @@
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "udp_server.hpp"
+
+/**
+ * @brief 4M packets from 128 peers dispatched through a UDPServer::ObserverTable,
+ * against what it replaced: a shared lock, an unordered_map lookup and a
+ * copy of the observer vector per packet. The map is timed with the old
+ * std::hash<Machine>, which combined the port as (h2 < 1), and with the
+ * fixed one. Peers are either ports of one host or hosts on one port.
+ *
+ */
+
+typedef std::chrono::steady_clock Clock;
+
+static constexpr std::size_t kPeers = 128;
+static constexpr std::size_t kPackets = 4000000;
+
+class CountingObserver final : public UDPServer::Observer
+{
+public:
+    std::size_t n_bytes{0};
+
+    inline void Count(const PacketView &packet) noexcept
+    {
+        n_bytes += packet.size();
+    }
+
+protected:
+    void Notify(const PacketView &packet) final
+    {
+        Count(packet);
+    }
+};
+
+struct OldHash
+{
+    inline std::size_t operator()(const Machine &m) const noexcept
+    {
+        std::size_t h1 = std::hash<in_addr_t>{}(m.ip);
+        std::size_t h2 = std::hash<in_port_t>{}(m.port);
+        return h1 ^ (h2 < 1);
+    }
+};
+
+typedef std::unordered_map<Machine, std::vector<UDPServer::Observer *>> ObserverMap;
+
+template <typename Hash>
+static double LockedMapNs(const ObserverMap &observers, const std::vector<Machine> &trace, const PacketView &packet)
+{
+    std::shared_mutex mutex;
+    std::unordered_map<Machine, std::vector<UDPServer::Observer *>, Hash> map(observers.begin(), observers.end());
+
+    auto t0 = Clock::now();
+    for (const auto &machine : trace)
+    {
+        mutex.lock_shared();
+        std::vector<UDPServer::Observer *> found(map[machine]);
+        mutex.unlock_shared();
+
+        for (const auto observer : found)
+        {
+            static_cast<CountingObserver *>(observer)->Count(packet);
+        }
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / static_cast<double>(trace.size());
+}
+
+static double TableNs(const ObserverMap &observers, const std::vector<Machine> &trace, const PacketView &packet)
+{
+    UDPServer::ObserverTable table;
+    table.Build(observers);
+
+    auto t0 = Clock::now();
+    for (const auto &machine : trace)
+    {
+        auto [begin, end] = table.Find(machine);
+        for (auto observer = begin; observer != end; ++observer)
+        {
+            static_cast<CountingObserver *>(*observer)->Count(packet);
+        }
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / static_cast<double>(trace.size());
+}
+
+int main()
+{
+    const std::string bytes(64, 'x');
+    const PacketView packet(bytes);
+
+    for (const bool one_host : {true, false})
+    {
+        std::vector<CountingObserver> counters(kPeers);
+        std::vector<Machine> peers;
+        ObserverMap observers;
+        for (std::size_t i = 0; i < kPeers; i++)
+        {
+            const auto index = static_cast<std::uint32_t>(i);
+            peers.push_back(one_host ? Machine{htonl(0x7f000001), htons(static_cast<in_port_t>(11001 + index))}
+                                     : Machine{htonl(0x0a000000 + index), htons(11001)});
+            observers[peers.back()].push_back(&counters[i]);
+        }
+
+        std::mt19937 rng(1);
+        std::vector<Machine> trace(kPackets);
+        for (auto &machine : trace)
+        {
+            machine = peers[rng() % kPeers];
+        }
+
+        std::printf("%s, %zu peers, ns per packet\n", one_host ? "one host, ports 11001.." : "one port, hosts 10.0.0.0..", kPeers);
+        std::printf("  lock + map + copy, old hash    %6.1f\n", LockedMapNs<OldHash>(observers, trace, packet));
+        std::printf("  lock + map + copy, fixed hash  %6.1f\n", LockedMapNs<std::hash<Machine>>(observers, trace, packet));
+        std::printf("  ObserverTable                  %6.1f\n", TableNs(observers, trace, packet));
+
+        std::size_t total = 0;
+        for (const auto &counter : counters)
+        {
+            total += counter.n_bytes;
+        }
+        if (total != 3 * kPackets * bytes.size())
+        {
+            std::printf("  packets went to the wrong observers\n");
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include <map>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "perfect_link.hpp"
+
+/**
+ * @brief 1M messages through a PerfectLink::OutboundQueue against the
+ * std::map<Seq, Outgoing> it replaced (payload in a vector, as it was):
+ * inserting them, iterating over the ones in flight, and acking them
+ * 64 at a time (63 selective acks, then a cumulative one).
+ *
+ */
+
+typedef std::chrono::steady_clock Clock;
+typedef PerfectLink::Message::Seq Seq;
+
+static constexpr Seq kMessages = 1 << 20;
+static constexpr Seq kAckBlock = 64;
+static constexpr int kRounds = 3;
+
+struct MapOutgoing
+{
+  Clock::time_point sent_at;
+  Clock::time_point deadline;
+  unsigned int transmissions{0};
+  std::vector<char> payload;
+};
+
+static double ElapsedNs(Clock::time_point from, Clock::time_point to)
+{
+  return std::chrono::duration<double, std::nano>(to - from).count();
+}
+
+int main()
+{
+  const char payload[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+  double insert_ring = 0, insert_map = 0;
+  double iterate_ring = 0, iterate_map = 0;
+  double ack_ring = 0, ack_map = 0;
+  volatile std::size_t sink = 0;
+  bool emptied = true;
+
+  for (int round = 0; round < kRounds; round++)
+  {
+    PerfectLink::OutboundQueue queue;
+    std::map<Seq, MapOutgoing> map;
+
+    auto t0 = Clock::now();
+    for (Seq seq = 1; seq <= kMessages; seq++)
+    {
+      queue.Push(seq, SharedPayload(payload, sizeof(payload)));
+    }
+    insert_ring += ElapsedNs(t0, Clock::now());
+
+    while (queue.Admit() != nullptr)
+    {
+    }
+
+    t0 = Clock::now();
+    for (Seq seq = 1; seq <= kMessages; seq++)
+    {
+      map[seq].payload.assign(payload, payload + sizeof(payload));
+    }
+    insert_map += ElapsedNs(t0, Clock::now());
+
+    t0 = Clock::now();
+    const Seq end = queue.next_unsent();
+    for (Seq seq = queue.NextInFlight(queue.base(), end); seq < end; seq = queue.NextInFlight(seq + 1, end))
+    {
+      sink = sink + queue.at(seq).payload.size();
+    }
+    iterate_ring += ElapsedNs(t0, Clock::now());
+
+    t0 = Clock::now();
+    for (const auto &[seq, outgoing] : map)
+    {
+      sink = sink + outgoing.payload.size();
+    }
+    iterate_map += ElapsedNs(t0, Clock::now());
+
+    t0 = Clock::now();
+    for (Seq block = 1; block <= kMessages; block += kAckBlock)
+    {
+      for (Seq seq = block + 1; seq < block + kAckBlock && seq <= kMessages; seq++)
+      {
+        if (queue.InFlight(seq))
+        {
+          queue.Erase(seq);
+        }
+      }
+      if (queue.InFlight(block))
+      {
+        queue.Erase(block);
+      }
+    }
+    ack_ring += ElapsedNs(t0, Clock::now());
+
+    t0 = Clock::now();
+    for (Seq block = 1; block <= kMessages; block += kAckBlock)
+    {
+      for (Seq seq = block + 1; seq < block + kAckBlock && seq <= kMessages; seq++)
+      {
+        map.erase(seq);
+      }
+      map.erase(map.begin(), map.lower_bound(block + 1));
+    }
+    ack_map += ElapsedNs(t0, Clock::now());
+
+    emptied = emptied && queue.empty() && map.empty();
+  }
+
+  // Steady state: the ring already grew to fit a window, so pushing does not allocate slots
+  PerfectLink::OutboundQueue grown;
+  Seq seq = 1;
+  for (; seq <= kMessages; seq++)
+  {
+    grown.Push(seq, SharedPayload(payload, sizeof(payload)));
+  }
+  while (grown.Admit() != nullptr)
+  {
+  }
+  for (Seq acked = 1; acked < seq; acked++)
+  {
+    grown.Erase(acked);
+  }
+
+  auto t0 = Clock::now();
+  for (const Seq end = seq + kMessages; seq < end; seq++)
+  {
+    grown.Push(seq, SharedPayload(payload, sizeof(payload)));
+  }
+  const double insert_grown = ElapsedNs(t0, Clock::now());
+
+  const double n = static_cast<double>(kMessages) * kRounds;
+  std::printf("           ring      std::map   (ns per message)\n");
+  std::printf("insert   %7.1f   %7.1f\n", insert_ring / n, insert_map / n);
+  std::printf("iterate  %7.1f   %7.1f\n", iterate_ring / n, iterate_map / n);
+  std::printf("ack      %7.1f   %7.1f\n", ack_ring / n, ack_map / n);
+  std::printf("insert into a grown ring %.1f\n", insert_grown / kMessages);
+
+  return emptied ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <memory_resource>
+
+#include "peer_array.hpp"
+#include "reorder_window.hpp"
+
+/**
+ * @brief The deliver path with 16, 128 and 256 processes: a delivered
+ * check on every received copy, then on the first copy an insert into the
+ * author's delivered window and its FIFO reorder window. Once with the
+ * per author state in a PeerArray and once in the std::pmr::unordered_map
+ * the array replaced, both holding the same ReorderWindows.
+ *
+ */
+
+typedef std::chrono::steady_clock Clock;
+typedef PeerArray<ReorderWindow>::Id Id;
+typedef ReorderWindow::Seq Seq;
+typedef std::pair<Id, Seq> Event;
+
+static constexpr std::size_t kEvents = 8000000;
+static constexpr std::size_t kWindow = 4096;
+static constexpr int kRepeats = 3;
+
+struct MapState
+{
+  std::pmr::unordered_map<Id, ReorderWindow> delivered;
+  std::pmr::unordered_map<Id, ReorderWindow> fifo;
+
+  MapState(Id n, std::pmr::memory_resource *resource) : delivered(resource), fifo(resource)
+  {
+    for (Id author = 1; author <= n; author++)
+    {
+      delivered.try_emplace(author, kWindow, resource);
+      fifo.try_emplace(author, kWindow, resource);
+    }
+  }
+
+  inline bool Contains(const Event &event) const
+  {
+    const auto it = delivered.find(event.first);
+    return it != delivered.end() && it->second.Contains(event.second);
+  }
+
+  inline Seq Deliver(const Event &event)
+  {
+    delivered.at(event.first).Insert(event.second);
+    const auto run = fifo.at(event.first).Insert(event.second);
+    return run.end - run.first;
+  }
+};
+
+struct ArrayState
+{
+  PeerArray<ReorderWindow> delivered;
+  PeerArray<ReorderWindow> fifo;
+
+  ArrayState(Id n, std::pmr::memory_resource *resource)
+  {
+    delivered.Resize(n, kWindow, resource);
+    fifo.Resize(n, kWindow, resource);
+  }
+
+  inline bool Contains(const Event &event) const
+  {
+    return delivered.Contains(event.first) && delivered[event.first].Contains(event.second);
+  }
+
+  inline Seq Deliver(const Event &event)
+  {
+    delivered[event.first].Insert(event.second);
+    const auto run = fifo[event.first].Insert(event.second);
+    return run.end - run.first;
+  }
+};
+
+/**
+ * @brief Copies from random authors, mostly the author's next seq, one
+ * in eight a recent one again as a relayed duplicate
+ *
+ */
+static std::vector<Event> MakeEvents(Id n)
+{
+  std::mt19937 rng(1);
+  std::vector<Seq> next(std::size_t{n} + 1, 1);
+  std::vector<Event> events;
+  events.reserve(kEvents);
+
+  while (events.size() < kEvents)
+  {
+    const Id author = 1 + static_cast<Id>(rng() % n);
+    Seq seq = next[author];
+    if (rng() % 8 == 0 && seq > 4)
+    {
+      seq -= 1 + static_cast<Seq>(rng() % 4);
+    }
+    else
+    {
+      next[author]++;
+    }
+    events.emplace_back(author, seq);
+  }
+
+  return events;
+}
+
+template <typename State>
+static double Run(Id n, const std::vector<Event> &events, Seq &delivered)
+{
+  std::pmr::unsynchronized_pool_resource pool;
+  State state(n, &pool);
+
+  delivered = 0;
+  const auto t0 = Clock::now();
+  for (const auto &event : events)
+  {
+    if (!state.Contains(event))
+    {
+      delivered += state.Deliver(event);
+    }
+  }
+  const auto t1 = Clock::now();
+
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(events.size());
+}
+
+int main()
+{
+  bool ok = true;
+
+  for (const Id n : {Id{16}, Id{128}, Id{256}})
+  {
+    const auto events = MakeEvents(n);
+    double map_ns = 1e9;
+    double array_ns = 1e9;
+    Seq map_delivered = 0;
+    Seq array_delivered = 0;
+
+    for (int repeat = 0; repeat < kRepeats; repeat++)
+    {
+      map_ns = std::min(map_ns, Run<MapState>(n, events, map_delivered));
+      array_ns = std::min(array_ns, Run<ArrayState>(n, events, array_delivered));
+    }
+
+    std::printf("%3u processes  unordered_map %.1f ns/copy  PeerArray %.1f ns/copy  (%u delivered)\n",
+                n, map_ns, array_ns, array_delivered);
+    ok = ok && map_delivered == array_delivered;
+  }
+
+  return ok ? 0 : 1;
+}
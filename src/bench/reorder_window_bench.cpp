@@ -0,0 +1,170 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <memory_resource>
+
+#include "reorder_window.hpp"
+
+/**
+ * @brief 4M seqs of one author arriving in randomized orders, each
+ * delivered through a ReorderWindow and through the std::set code FIFO
+ * used before it. The arrival order is shuffled within consecutive blocks
+ * of k seqs, so a seq is at most k - 1 places from where it belongs, and
+ * one copy in twenty is repeated at a random seq. Both must deliver the
+ * same seqs in the same order.
+ *
+ */
+
+typedef std::chrono::steady_clock Clock;
+typedef ReorderWindow::Seq Seq;
+
+static constexpr Seq kSeqs = 4000000;
+static constexpr std::size_t kWindow = 4096;
+static constexpr int kRepeats = 3;
+
+/**
+ * @brief What FIFO DeliverInternal did per author before the window
+ *
+ */
+class SetReorder
+{
+private:
+  Seq next_{1};
+  std::pmr::set<Seq> pending_;
+
+public:
+  explicit SetReorder(std::pmr::memory_resource *resource) : pending_(resource) {}
+
+  template <typename F>
+  void Insert(Seq seq, F &&deliver)
+  {
+    if (seq < next_)
+    {
+      return;
+    }
+
+    std::vector<Seq> to_remove;
+    to_remove.reserve(pending_.size());
+
+    pending_.insert(seq);
+    for (const auto pending : pending_)
+    {
+      if (pending > next_)
+      {
+        break;
+      }
+
+      to_remove.emplace_back(pending);
+      deliver(pending);
+      next_++;
+    }
+
+    for (const auto pending : to_remove)
+    {
+      pending_.erase(pending);
+    }
+  }
+};
+
+class WindowReorder
+{
+private:
+  ReorderWindow window_;
+
+public:
+  explicit WindowReorder(std::pmr::memory_resource *resource) : window_(kWindow, resource) {}
+
+  template <typename F>
+  void Insert(Seq seq, F &&deliver)
+  {
+    const auto run = window_.Insert(seq);
+    for (auto pending = run.first; pending != run.end; pending++)
+    {
+      deliver(pending);
+    }
+  }
+};
+
+static std::vector<Seq> MakeArrivals(Seq block)
+{
+  std::mt19937 rng(block);
+  std::vector<Seq> order(kSeqs);
+  for (Seq i = 0; i < kSeqs; i++)
+  {
+    order[i] = i + 1;
+  }
+  for (Seq i = 0; i < kSeqs; i += block)
+  {
+    std::shuffle(order.begin() + i, order.begin() + std::min(kSeqs, i + block), rng);
+  }
+
+  std::vector<Seq> arrivals;
+  arrivals.reserve(kSeqs + kSeqs / 16);
+  for (const auto seq : order)
+  {
+    arrivals.push_back(seq);
+    if (rng() % 20 == 0)
+    {
+      arrivals.push_back(1 + static_cast<Seq>(rng() % kSeqs));
+    }
+  }
+
+  return arrivals;
+}
+
+template <typename Reorder>
+static double Run(const std::vector<Seq> &arrivals, std::uint64_t &digest, Seq &delivered)
+{
+  std::pmr::unsynchronized_pool_resource pool;
+  Reorder reorder(&pool);
+
+  digest = 0;
+  delivered = 0;
+  const auto deliver = [&](Seq seq)
+  {
+    digest = digest * 31 + seq;
+    delivered++;
+  };
+
+  const auto t0 = Clock::now();
+  for (const auto seq : arrivals)
+  {
+    reorder.Insert(seq, deliver);
+  }
+  const auto t1 = Clock::now();
+
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(arrivals.size());
+}
+
+int main()
+{
+  bool ok = true;
+
+  for (const Seq block : {Seq{1}, Seq{16}, Seq{256}, Seq{4096}, Seq{65536}})
+  {
+    const auto arrivals = MakeArrivals(block);
+    double set_ns = 1e9;
+    double window_ns = 1e9;
+    std::uint64_t set_digest = 0;
+    std::uint64_t window_digest = 0;
+    Seq set_delivered = 0;
+    Seq window_delivered = 0;
+
+    for (int repeat = 0; repeat < kRepeats; repeat++)
+    {
+      set_ns = std::min(set_ns, Run<SetReorder>(arrivals, set_digest, set_delivered));
+      window_ns = std::min(window_ns, Run<WindowReorder>(arrivals, window_digest, window_delivered));
+    }
+
+    const bool same = set_digest == window_digest && set_delivered == kSeqs && window_delivered == kSeqs;
+    std::printf("block %5u  std::set %6.1f ns/seq  ReorderWindow %6.1f ns/seq  %s\n",
+                block, set_ns, window_ns, same ? "same order" : "MISMATCH");
+    ok = ok && same;
+  }
+
+  return ok ? 0 : 1;
+}
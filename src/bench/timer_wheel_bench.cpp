@@ -0,0 +1,107 @@
+#include <map>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "timer_wheel.hpp"
+
+/**
+ * @brief 1M timers spread over 2 s on the wheel, advanced in 5 ms steps,
+ * against a full scan of a std::map with the same deadlines (the sweep
+ * the wheel replaced). Also ticks a wheel whose 1M timers are all far away.
+ *
+ */
+
+typedef TimerWheel::Clock Clock;
+
+static constexpr std::size_t kTimers = 1000000;
+static constexpr int kScanTicks = 40; // The scan is slow, only the first ticks are timed
+
+static double ElapsedNs(Clock::time_point from, Clock::time_point to)
+{
+  return std::chrono::duration<double, std::nano>(to - from).count();
+}
+
+int main()
+{
+  const auto start = Clock::now();
+  std::mt19937_64 rng(1);
+
+  std::vector<Clock::time_point> deadlines(kTimers);
+  for (auto &deadline : deadlines)
+  {
+    deadline = start + std::chrono::microseconds(rng() % 2000000);
+  }
+
+  TimerWheel wheel(std::chrono::milliseconds(1), start);
+  auto t0 = Clock::now();
+  for (std::size_t key = 0; key < kTimers; key++)
+  {
+    wheel.Schedule(key, deadlines[key]);
+  }
+  const double schedule_ns = ElapsedNs(t0, Clock::now());
+
+  std::map<std::uint64_t, Clock::time_point> scanned;
+  for (std::size_t key = 0; key < kTimers; key++)
+  {
+    scanned.emplace(key, deadlines[key]);
+  }
+
+  std::vector<TimerWheel::Key> expired;
+  std::size_t fired = 0;
+  std::size_t early = 0;
+  double advance_ns = 0;
+  double scan_ns = 0;
+  int ticks = 0;
+  volatile std::size_t sink = 0;
+
+  for (auto now = start; fired < kTimers; now += std::chrono::milliseconds(5), ticks++)
+  {
+    expired.clear();
+    t0 = Clock::now();
+    wheel.Advance(now, expired);
+    advance_ns += ElapsedNs(t0, Clock::now());
+
+    for (const auto key : expired)
+    {
+      early += deadlines[key] > now;
+    }
+    fired += expired.size();
+
+    if (ticks < kScanTicks)
+    {
+      t0 = Clock::now();
+      std::size_t due = 0;
+      for (const auto &[key, deadline] : scanned)
+      {
+        due += deadline <= now;
+      }
+      sink = sink + due;
+      scan_ns += ElapsedNs(t0, Clock::now());
+    }
+  }
+
+  TimerWheel idle(std::chrono::milliseconds(1), start);
+  for (std::size_t key = 0; key < kTimers; key++)
+  {
+    idle.Schedule(key, start + std::chrono::hours(1) + std::chrono::microseconds(key));
+  }
+
+  expired.clear();
+  t0 = Clock::now();
+  for (int tick = 1; tick <= 1000; tick++)
+  {
+    idle.Advance(start + std::chrono::milliseconds(5 * tick), expired);
+  }
+  const double idle_ns = ElapsedNs(t0, Clock::now());
+
+  std::printf("schedule                  %.1f ns/timer\n", schedule_ns / kTimers);
+  std::printf("advance                   %.1f us/tick, %.1f ns/expired timer (%d ticks)\n",
+              advance_ns / ticks / 1000, advance_ns / kTimers, ticks);
+  std::printf("std::map full scan        %.1f us/tick\n", scan_ns / kScanTicks / 1000);
+  std::printf("idle tick, 1M outstanding %.3f us/tick\n", idle_ns / 1000 / 1000);
+  std::printf("fired %zu of %zu, %zu before their deadline, %zu idle\n", fired, kTimers, early, expired.size());
+
+  return early == 0 && fired == kTimers && expired.empty() ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <memory_resource>
+
+#include "broadcast.hpp"
+
+/**
+ * @brief Processes that relayed each pending message, kept as a row of
+ * bits indexed by process id. Ids are dense, so a row is a handful of
+ * words. Rows sit back to back in one slab and are recycled through a
+ * free list. Acking is a hash lookup and a bit set, and counting the
+ * acks is one popcount per 64 processes.
+ *
+ */
+class AckTable
+{
+public:
+  typedef Broadcast::Message::Id Key;
+  typedef PerfectLink::Id Process;
+
+  static constexpr std::size_t kWordBits = sizeof(std::uint64_t) * 8;
+
+private:
+  std::size_t row_words_{1};
+  std::pmr::unordered_map<Key, std::uint32_t> rows_; // Row index by message
+  std::pmr::vector<std::uint64_t> words_;            // row_words_ per row
+  std::pmr::vector<std::uint32_t> free_rows_;
+
+public:
+  explicit AckTable(std::pmr::memory_resource *resource) noexcept;
+
+  /**
+   * @brief Widens the rows to fit ids up to max_process, cheapest
+   * while the table is empty (peers are added before starting)
+   *
+   */
+  void Reserve(Process max_process);
+
+  /**
+   * @brief Returns how many distinct processes acked key so far, this one included
+   *
+   */
+  std::size_t Ack(const Key &key, Process process);
+
+  /**
+   * @brief Distinct processes that acked key, 0 if none did
+   *
+   */
+  [[nodiscard]] std::size_t Count(const Key &key) const noexcept;
+
+  /**
+   * @brief Whether key has a row, that is at least one ack
+   *
+   */
+  [[nodiscard]] inline bool Contains(const Key &key) const noexcept
+  {
+    return rows_.count(key) > 0;
+  }
+
+  /**
+   * @brief Whether process acked key
+   *
+   */
+  [[nodiscard]] bool Contains(const Key &key, Process process) const noexcept;
+
+  void Erase(const Key &key);
+
+  /**
+   * @brief Number of messages with at least one ack
+   *
+   */
+  [[nodiscard]] inline std::size_t size() const noexcept
+  {
+    return rows_.size();
+  }
+
+  [[nodiscard]] inline std::size_t row_words() const noexcept
+  {
+    return row_words_;
+  }
+
+private:
+  [[nodiscard]] inline std::uint64_t *Row(std::uint32_t row) noexcept
+  {
+    return words_.data() + row * row_words_;
+  }
+
+  [[nodiscard]] std::size_t Count(const std::uint64_t *row) const noexcept;
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Counts every heap allocation the process makes, by replacing
+ * the global operator new. One relaxed atomic increment per allocation.
+ *
+ */
+namespace alloc_counter
+{
+    [[nodiscard]] std::uint64_t n_allocations() noexcept;
+} // namespace alloc_counter
@@ -33,7 +33,7 @@ public:
 
     Id id;
     PerfectLink::Id sender;
-    std::vector<char> payload;
+    PacketView payload; // Only valid for the duration of the call it is passed to
   };
 
 protected:
@@ -65,7 +65,7 @@ protected:
 
 public:
   static std::size_t Serialize(const Broadcast::Message &msg, char *buffer) noexcept;
-  static std::optional<Message> Parse(PerfectLink::Id sender_id, const std::vector<char> &bytes) noexcept;
+  static std::optional<Message> Parse(PerfectLink::Id sender_id, const PacketView &packet) noexcept;
 };
 
 template <>
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Delay based window on the number of messages in flight, in the
+ * spirit of LEDBAT. Each completion gives a latency sample. The base delay
+ * is the smallest sample seen recently, and the current delay is the
+ * smallest of the last few samples, so a lost and retransmitted message
+ * does not count as queueing. The window grows while the queueing delay
+ * (current - base) is under the target and shrinks once it is over, by up
+ * to gain of itself per window of completions either way.
+ *
+ */
+class DelayWindow
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr std::size_t kFilterSize = 16;
+  static constexpr double kGain = 0.125;
+
+private:
+  const double min_;
+  const double max_;
+  const Clock::duration target_;
+  const Clock::duration base_interval_;
+
+  double window_;
+
+  // Base delay, minimum over the current interval and the one before it
+  Clock::time_point interval_start_{};
+  Clock::duration interval_min_{Clock::duration::max()};
+  Clock::duration previous_min_{Clock::duration::max()};
+
+  std::array<Clock::duration, kFilterSize> recent_{};
+  std::size_t n_samples_{0};
+
+public:
+  DelayWindow(double initial, double min, double max, Clock::duration target, Clock::duration base_interval) noexcept;
+
+  /**
+   * @brief Accounts for a completion that took latency, with in_flight
+   * still outstanding. The window only grows while it is being used.
+   *
+   */
+  void OnCompletion(Clock::duration latency, std::size_t in_flight, Clock::time_point now) noexcept;
+
+  /**
+   * @brief Starts over from window, the samples are kept
+   *
+   */
+  void Resize(double window) noexcept;
+
+  [[nodiscard]] inline unsigned int window() const noexcept
+  {
+    return static_cast<unsigned int>(window_);
+  }
+
+  /**
+   * @brief Both are zero until the first completion
+   *
+   */
+  [[nodiscard]] Clock::duration base_delay() const noexcept;
+
+  [[nodiscard]] Clock::duration current_delay() const noexcept;
+};
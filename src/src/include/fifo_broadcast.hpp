@@ -1,20 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <mutex>
 #include <unordered_set>
 
+#include "reorder_window.hpp"
 #include "uniform_reliable_broadcast.hpp"
 
+// Seqs past the next one in order that an author's reorder window
+// keeps as bits, further ones go to the window's overflow set. A full
+// own message window of a small system fits
+#ifndef FIFO_REORDER_WINDOW
+#define FIFO_REORDER_WINDOW 4096
+#endif
+
 class ReliableFIFOBroadcast final : public BestEffortBroadcast
 {
 private:
-    struct PeerState
-    {
-        Broadcast::Message::Id::Seq next{1};
-        std::set<Broadcast::Message::Id::Seq> pending; // std::set needed for in order iteration
-    };
-
-private:
-    std::unordered_map<PerfectLink::Id, PeerState> peer_state_;
+    std::mutex deliver_mutex_; // Receive shards deliver concurrently, the windows and the log order need one at a time
+    PeerArray<ReorderWindow> peer_state_;
 
 public:
     explicit ReliableFIFOBroadcast(Logger &logger, PerfectLink::Id id) noexcept
@@ -22,6 +26,13 @@ public:
 
     ~ReliableFIFOBroadcast() noexcept override = default;
 
+    inline void Add(std::unique_ptr<PerfectLink> pl) noexcept final
+    {
+        const PerfectLink::Id id = pl->target_id();
+        BestEffortBroadcast::Add(std::move(pl));
+        peer_state_.Resize(std::max(id, id_), std::size_t{FIFO_REORDER_WINDOW}, std::pmr::get_default_resource());
+    }
+
 protected:
     inline void SendInternal(const Broadcast::Message &msg) noexcept final
     {
@@ -47,21 +58,30 @@ protected:
 class UniformFIFOBroadcast final : public UniformReliableBroadcast
 {
 private:
-    struct PeerState
-    {
-        Broadcast::Message::Id::Seq next{1};
-        std::set<Broadcast::Message::Id::Seq> pending; // std::set for inorder iteration
-    };
-
-private:
-    std::unordered_map<PerfectLink::Id, PeerState> peer_state_;
+    // Only touched by deliveries, which the URB runs one at a time
+    TrackedResource reorder_memory_;
+    PeerArray<ReorderWindow> peer_state_;
 
 public:
-    explicit UniformFIFOBroadcast(Logger &logger, PerfectLink::Id id) noexcept
-        : UniformReliableBroadcast(logger, id) {}
+    explicit UniformFIFOBroadcast(Logger &logger, PerfectLink::Id id, bool pooled = false, bool digest_acks = false)
+        : UniformReliableBroadcast(logger, id, pooled, digest_acks), reorder_memory_(pooled) {}
 
     ~UniformFIFOBroadcast() noexcept override = default;
 
+    inline void Add(std::unique_ptr<PerfectLink> pl) noexcept final
+    {
+        const PerfectLink::Id id = pl->target_id();
+        UniformReliableBroadcast::Add(std::move(pl));
+        peer_state_.Resize(std::max(id, id_), std::size_t{FIFO_REORDER_WINDOW}, &reorder_memory_);
+    }
+
+    [[nodiscard]] MemoryStats memory_stats() const noexcept final
+    {
+        auto stats = UniformReliableBroadcast::memory_stats();
+        stats.emplace_back("fifo_reorder", reorder_memory_.stats());
+        return stats;
+    }
+
 protected:
     inline void SendInternal(const Broadcast::Message &msg) noexcept final
     {
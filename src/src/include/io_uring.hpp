@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+/**
+ * @brief Minimal io_uring ring on top of the raw syscalls: maps the
+ * submission and completion queues and hands out sqes and cqes.
+ * Not thread safe, a ring belongs to the thread that submits to it.
+ *
+ */
+class IoUring
+{
+private:
+  int fd_{-1};
+  io_uring_params params_{};
+
+  void *sq_ring_{nullptr};
+  void *cq_ring_{nullptr};
+  std::size_t sq_ring_size_{0};
+  std::size_t cq_ring_size_{0};
+
+  io_uring_sqe *sqes_{nullptr};
+  std::size_t sqes_size_{0};
+
+  unsigned *sq_head_;
+  unsigned *sq_tail_;
+  unsigned *sq_array_;
+  unsigned sq_mask_;
+  unsigned sq_local_tail_;
+  unsigned to_submit_{0};
+
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned cq_mask_;
+  io_uring_cqe *cqes_;
+
+public:
+  /**
+   * @brief Throws if the kernel does not support io_uring
+   *
+   */
+  explicit IoUring(unsigned entries);
+
+  ~IoUring() noexcept;
+
+  IoUring(const IoUring &) = delete;
+  IoUring &operator=(const IoUring &) = delete;
+
+  /**
+   * @brief Zeroed sqe to fill in, nullptr if the submission queue is full
+   *
+   */
+  io_uring_sqe *GetSqe() noexcept;
+
+  /**
+   * @brief Submits the sqes handed out so far, waiting
+   * for wait_nr completions as part of the same syscall
+   *
+   * @return int number of sqes submitted, -errno on failure
+   */
+  int Submit(unsigned wait_nr = 0) noexcept;
+
+  /**
+   * @brief Oldest completion not yet seen, nullptr if there is none
+   *
+   */
+  io_uring_cqe *PeekCqe() noexcept;
+
+  void SeenCqe() noexcept;
+
+  int RegisterFiles(const int *fds, unsigned n) noexcept;
+
+  int RegisterBuffers(const iovec *iovecs, unsigned n) noexcept;
+
+  int RegisterBufRing(io_uring_buf_reg &reg) noexcept;
+
+  /**
+   * @brief Readable (for epoll) while completions are waiting
+   *
+   */
+  [[nodiscard]] inline int fd() const noexcept
+  {
+    return fd_;
+  }
+
+private:
+  void Unmap() noexcept;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <mutex>
 #include <string>
 #include <fstream>
 #include <iostream>
@@ -9,6 +10,10 @@ class Logger
 private:
     std::ofstream file_;
 
+    // Lines are logged from several threads, e.g. sends and deliveries
+    const bool thread_safe_;
+    std::mutex mutex_;
+
 public:
     explicit Logger(const std::string &fname, bool thread_safe = true);
 
@@ -26,7 +31,17 @@ public:
 
     inline friend Logger &operator<<(Logger &logger, const std::string &text) noexcept
     {
+        if (logger.thread_safe_)
+        {
+            logger.mutex_.lock();
+        }
+
         logger.file_ << text << "\n";
+
+        if (logger.thread_safe_)
+        {
+            logger.mutex_.unlock();
+        }
 #ifdef DEBUG
         std::cout << "[DLOG] " << text << "\n";
 #endif
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <string_view>
+
+// Released buffers kept for reuse, past this they are freed
+#ifndef PACKET_POOL_MAX_FREE
+#define PACKET_POOL_MAX_FREE 1024
+#endif
+
+/**
+ * @brief Fixed capacity datagram buffers, each owned by one Ref and
+ * recycled through a free list once it goes away. A datagram is received
+ * straight into one and handed up the stack as views into it, a layer
+ * that has to keep the bytes past the call copies them.
+ *
+ */
+class PacketPool
+{
+private:
+    struct Buffer
+    {
+        PacketPool *pool;
+        std::size_t size{0};
+        std::unique_ptr<char[]> data;
+    };
+
+public:
+    class Ref
+    {
+        friend class PacketPool;
+
+    private:
+        Buffer *buffer_{nullptr};
+
+        explicit Ref(Buffer *buffer) noexcept : buffer_(buffer) {}
+
+    public:
+        Ref() noexcept = default;
+
+        Ref(const Ref &) = delete;
+
+        Ref(Ref &&other) noexcept : buffer_(other.buffer_)
+        {
+            other.buffer_ = nullptr;
+        }
+
+        Ref &operator=(Ref other) noexcept
+        {
+            std::swap(buffer_, other.buffer_);
+            return *this;
+        }
+
+        ~Ref() noexcept
+        {
+            if (buffer_ != nullptr)
+            {
+                buffer_->pool->Release(buffer_);
+            }
+        }
+
+        [[nodiscard]] inline explicit operator bool() const noexcept
+        {
+            return buffer_ != nullptr;
+        }
+
+        [[nodiscard]] inline char *data() const noexcept
+        {
+            return buffer_->data.get();
+        }
+
+        [[nodiscard]] inline std::size_t size() const noexcept
+        {
+            return buffer_->size;
+        }
+
+        /**
+         * @brief Length of the datagram received into the buffer
+         *
+         */
+        inline void resize(std::size_t size) noexcept
+        {
+            buffer_->size = size;
+        }
+
+        [[nodiscard]] inline std::string_view bytes() const noexcept
+        {
+            return {buffer_->data.get(), buffer_->size};
+        }
+    };
+
+private:
+    const std::size_t capacity_;
+
+    std::mutex mutex_;
+    std::vector<Buffer *> free_;
+    std::atomic<std::uint64_t> n_allocated_{0};
+
+public:
+    explicit PacketPool(std::size_t capacity);
+
+    /**
+     * @brief Every Ref must be gone by then
+     *
+     */
+    ~PacketPool() noexcept;
+
+    PacketPool(const PacketPool &) = delete;
+    PacketPool &operator=(const PacketPool &) = delete;
+
+    /**
+     * @brief A buffer of capacity() bytes
+     *
+     */
+    Ref Acquire();
+
+    [[nodiscard]] inline std::size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    /**
+     * @brief Buffers allocated so far, those recycled are not counted again
+     *
+     */
+    [[nodiscard]] inline std::uint64_t n_allocated() const noexcept
+    {
+        return n_allocated_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void Release(Buffer *buffer) noexcept;
+};
+
+/**
+ * @brief Bytes of a received datagram, or of a part of it, valid for the
+ * duration of the call it is passed to. The same goes for views of the
+ * caller's own memory (messages being sent, io_uring's provided buffers),
+ * a layer retaining any of them has to copy them.
+ *
+ */
+class PacketView
+{
+private:
+    std::string_view bytes_;
+
+public:
+    PacketView() noexcept = default;
+
+    explicit PacketView(std::string_view bytes) noexcept : bytes_(bytes) {}
+
+    explicit PacketView(const PacketPool::Ref &packet) noexcept : bytes_(packet.bytes()) {}
+
+    [[nodiscard]] inline const char *data() const noexcept
+    {
+        return bytes_.data();
+    }
+
+    [[nodiscard]] inline std::size_t size() const noexcept
+    {
+        return bytes_.size();
+    }
+
+    [[nodiscard]] inline const char *begin() const noexcept
+    {
+        return bytes_.data();
+    }
+
+    [[nodiscard]] inline const char *end() const noexcept
+    {
+        return bytes_.data() + bytes_.size();
+    }
+
+    [[nodiscard]] inline std::string_view bytes() const noexcept
+    {
+        return bytes_;
+    }
+
+    /**
+     * @brief View of len bytes at offset, both assumed to be within bounds
+     *
+     */
+    [[nodiscard]] inline PacketView Sub(std::size_t offset, std::size_t len) const noexcept
+    {
+        return PacketView(std::string_view(bytes_.data() + offset, len));
+    }
+};
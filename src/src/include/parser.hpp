@@ -2,6 +2,7 @@
 
 #include <fstream>
 #include <netdb.h>
+#include <optional>
 #include <string>
 #include <unistd.h>
 #include <vector>
@@ -32,6 +33,25 @@ public:
     kFIFOBroadcast,
   };
 
+  enum IoModel
+  {
+    kThreads,
+    kEpoll,
+    kUring,
+  };
+
+  enum AllocModel
+  {
+    kHeap,
+    kPool,
+  };
+
+  enum AckModel
+  {
+    kRelay,
+    kDigest,
+  };
+
 private:
   const int argc_;
   char const *const *argv_;
@@ -49,6 +69,13 @@ private:
   unsigned n_messages_to_send_{};
 
   ExecMode exec_mode_{kFIFOBroadcast};
+  IoModel io_model_{kThreads};
+  AllocModel alloc_model_{kPool};
+  AckModel ack_model_{kRelay};
+  std::optional<std::size_t> recv_batch_;
+  std::optional<std::size_t> recv_shards_;
+  std::optional<std::size_t> send_batch_;
+  std::optional<std::size_t> mtu_;
 
 public:
   Parser(int argc, char const *const *argv, bool requires_config = true);
@@ -64,6 +91,13 @@ public:
   [[nodiscard]] unsigned int n_messages_to_send() const;
   [[nodiscard]] unsigned int target_id() const;
   [[nodiscard]] ExecMode exec_mode() const noexcept;
+  [[nodiscard]] IoModel io_model() const noexcept;
+  [[nodiscard]] AllocModel alloc_model() const noexcept;
+  [[nodiscard]] AckModel ack_model() const noexcept;
+  [[nodiscard]] std::optional<std::size_t> recv_batch() const noexcept;
+  [[nodiscard]] std::optional<std::size_t> recv_shards() const noexcept;
+  [[nodiscard]] std::optional<std::size_t> send_batch() const noexcept;
+  [[nodiscard]] std::optional<std::size_t> mtu() const noexcept;
   [[nodiscard]] Host local_host() const;
   [[nodiscard]] Host target_host() const;
 
@@ -74,7 +108,15 @@ private:
   bool ParseInternal();
 
   bool ParseId() noexcept;
-  void ParseMode();
+  void ParseOptions();
+  void ParseMode(const char *mode);
+  void ParseIo(const char *io);
+  void ParseAlloc(const char *alloc);
+  void ParseAcks(const char *acks);
+  void ParseRecvBatch(const char *recv_batch);
+  void ParseRecvShards(const char *recv_shards);
+  void ParseSendBatch(const char *send_batch);
+  void ParseMtu(const char *mtu);
   bool ParseHostPath() noexcept;
   bool ParseOutputPath() noexcept;
   bool ParseConfigPath() noexcept;
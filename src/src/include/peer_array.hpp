@@ -0,0 +1,127 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// Per process entries that different threads write are
+// padded to this, so two peers never share a cache line
+#ifndef PEER_ARRAY_ALIGNMENT
+#define PEER_ARRAY_ALIGNMENT 64
+#endif
+
+/**
+ * @brief Per process state indexed directly by id. Process ids are
+ * compact, 1 to n (the hosts file is rejected otherwise), so a lookup
+ * is an index into one contiguous block. Index 0 is never used. Sized
+ * from Add, before anything is received, and never grown on the receive
+ * path: ids from the wire past end_id are not processes of the system
+ * and are dropped by the owner.
+ *
+ */
+template <typename T, std::size_t kAlignment = PEER_ARRAY_ALIGNMENT>
+class PeerArray
+{
+public:
+  typedef unsigned int Id;
+
+private:
+  struct alignas(kAlignment) Slot
+  {
+    T value;
+
+    template <typename... Args>
+    explicit Slot(Args &&...args) : value(std::forward<Args>(args)...) {}
+
+    // Growing moves the entries even if moving might throw, copying
+    // a container would lose the memory resource it was given
+    Slot(const Slot &) = delete;
+    Slot(Slot &&) = default;
+  };
+
+  std::vector<Slot> slots_;
+
+public:
+  /**
+   * @brief Makes room for ids up to max_id, new entries are
+   * constructed from args
+   *
+   */
+  template <typename... Args>
+  void Resize(Id max_id, const Args &...args)
+  {
+    if (max_id < slots_.size())
+    {
+      return;
+    }
+
+    slots_.reserve(std::size_t{max_id} + 1);
+    while (slots_.size() <= max_id)
+    {
+      slots_.emplace_back(args...);
+    }
+  }
+
+  [[nodiscard]] inline bool Contains(Id id) const noexcept
+  {
+    return id < slots_.size();
+  }
+
+  [[nodiscard]] inline T &operator[](Id id) noexcept
+  {
+    return slots_[id].value;
+  }
+
+  [[nodiscard]] inline const T &operator[](Id id) const noexcept
+  {
+    return slots_[id].value;
+  }
+
+  /**
+   * @brief One past the highest id there is room for
+   *
+   */
+  [[nodiscard]] inline Id end_id() const noexcept
+  {
+    return static_cast<Id>(slots_.size());
+  }
+
+  class const_iterator
+  {
+  private:
+    const Slot *slot_;
+
+  public:
+    explicit const_iterator(const Slot *slot) noexcept : slot_(slot) {}
+
+    inline const T &operator*() const noexcept
+    {
+      return slot_->value;
+    }
+
+    inline const_iterator &operator++() noexcept
+    {
+      ++slot_;
+      return *this;
+    }
+
+    inline bool operator!=(const const_iterator &other) const noexcept
+    {
+      return slot_ != other.slot_;
+    }
+  };
+
+  /**
+   * @brief Every entry in id order, including the unused index 0
+   *
+   */
+  [[nodiscard]] inline const_iterator begin() const noexcept
+  {
+    return const_iterator(slots_.data());
+  }
+
+  [[nodiscard]] inline const_iterator end() const noexcept
+  {
+    return const_iterator(slots_.data() + slots_.size());
+  }
+};
@@ -1,7 +1,8 @@
 #pragma once
 
 #include <atomic>
-#include <ctime>
+#include <chrono>
+#include <cstdint>
 #include <list>
 #include <mutex>
 #include <optional>
@@ -15,9 +16,18 @@
 #include <vector>
 
 #include "logger.hpp"
+#include "seq_window.hpp"
+#include "peer_array.hpp"
+#include "shared_payload.hpp"
+#include "timer_wheel.hpp"
 #include "udp_client.hpp"
 #include "udp_server.hpp"
 
+// Initial number of slots of the outbound queue, it doubles when full
+#ifndef PERFECT_LINK_QUEUE_CAPACITY
+#define PERFECT_LINK_QUEUE_CAPACITY 256
+#endif
+
 class PerfectLink final : public UDPServer::Observer
 {
 public:
@@ -29,12 +39,16 @@ public:
     kMSG = true,
   };
 
+  /**
+   * @brief A received message, its payload views the datagram it came in
+   *
+   */
   struct Message
   {
     typedef unsigned int Seq;
 
     Seq seq;
-    std::vector<char> payload;
+    PacketView payload;
 
     inline friend bool operator<(const Message &m1, const Message &m2) noexcept
     {
@@ -55,27 +69,83 @@ public:
     };
   };
 
-  typedef Message::Seq Ack;
+  /**
+   * @brief Cumulative acknowledgement with a selective bitmap:
+   * every seq below next was received, and so was base + i
+   * for every bit i set in received
+   *
+   */
+  struct Ack
+  {
+    typedef std::uint64_t Bitmap;
+
+    Message::Seq next;
+    Message::Seq base;
+    Bitmap received;
+  };
 
-  static constexpr size_t kPacketPrefixSize = sizeof(PacketType) + sizeof(Message::Seq);
+  typedef std::uint16_t PayloadSize;
+
+  /**
+   * @brief A datagram is a sequence of frames, packed up to the client's mtu:
+   * ACK frame: [PacketType][Next][Base][Bitmap]
+   * MSG frame: [PacketType][Seq][PayloadSize][Payload]
+   *
+   */
+  static constexpr size_t kAckFrameSize = sizeof(PacketType) + 2 * sizeof(Message::Seq) + sizeof(Ack::Bitmap);
+  static constexpr size_t kMsgFrameHeaderSize = sizeof(PacketType) + sizeof(Message::Seq) + sizeof(PayloadSize);
+  static constexpr size_t kMaxPayloadSize = UDPServer::kMaxSendSize - kMsgFrameHeaderSize;
+
+  struct Stats
+  {
+    std::uint64_t links{0};
+    std::uint64_t acks_piggybacked{0};
+    std::uint64_t acks_standalone{0};
+    std::uint64_t transmissions{0};
+    std::uint64_t retransmissions{0};
+    double rto_ms{0};
+    double cwnd_bytes{0};
+
+    Stats &operator+=(const Stats &other) noexcept;
+  };
+
+  typedef std::chrono::steady_clock Clock;
 
 public:
-  class Manager
+  class Manager : public Reactor::Handler
   {
     friend class PerfectLink;
 
   protected:
-    static constexpr int kFinishSendingAllAcksMs = 100;
-    static constexpr int kFinishSendingAllMsgsMs = 100;
+    /**
+     * @brief Acks wait up to kMaxAckDelayMs for outgoing messages to ride on,
+     * a link with nothing going out by then acks alone after kAckDelayMs
+     *
+     */
+    static constexpr int kAckDelayMs = 5;
+    static constexpr int kMaxAckDelayMs = 20;
+
+    /**
+     * @brief Messages are (re)transmitted when their own deadline
+     * expires, the send thread checks for expired deadlines this often
+     *
+     */
+    static constexpr int kSendTickMs = 5;
 
     std::atomic<Id> n_processes_{1};
+    std::atomic<std::uint64_t> n_delivered_{0}; // Messages handed to the application
 
     std::thread ack_thread_;
     std::thread send_thread_;
     std::atomic_bool on_{false};
 
+    Reactor *reactor_{nullptr};
+    UDPClient::Batch reactor_batch_;
+
     Logger &logger_;
-    Shared<std::unordered_map<Id, std::unique_ptr<PerfectLink>>> perfect_links_;
+    Shared<TimerWheel> ack_timers_; // Keyed by link, armed when an ack becomes pending
+    // Read only once started, so packed rather than a cache line per link
+    Shared<PeerArray<std::unique_ptr<PerfectLink>, alignof(std::unique_ptr<PerfectLink>)>> perfect_links_;
 
   public:
     explicit Manager(Logger &logger) noexcept : logger_(logger){};
@@ -87,10 +157,43 @@ public:
     virtual void Stop() noexcept;
     virtual void Start() noexcept;
 
+    /**
+     * @brief Does the work of the threads on the reactor's thread instead,
+     * the reactor must be stopped before the manager
+     *
+     */
+    virtual void Start(Reactor &reactor) noexcept;
+
+    [[nodiscard]] Stats stats() noexcept;
+
+    [[nodiscard]] inline std::uint64_t n_delivered() const noexcept
+    {
+      return n_delivered_.load(std::memory_order_relaxed);
+    }
+
   protected:
     void SendAcks();
     void SendMessages();
 
+    bool OnTick() noexcept override;
+
+    /**
+     * @brief Return whether there is still work pending
+     *
+     */
+    bool SendDueAcks(UDPClient::Batch &batch) noexcept;
+    bool SendDueMessages(UDPClient::Batch &batch) noexcept;
+
+    static void Flush(UDPClient::Batch &batch) noexcept;
+
+    /**
+     * @brief New work came in, the reactor (if any) must not stay asleep
+     *
+     */
+    void Wake() noexcept;
+
+    void ScheduleAck(Id id, Clock::time_point deadline) noexcept;
+
     virtual void Notify(Id sender_id, const Message &msg) = 0;
   };
 
@@ -107,17 +210,234 @@ public:
 
 private:
   /**
-   * @brief This value should be the result of:
-   * (kFinishSendingAllMsgsMs + Network Delay + Peer Processing Time)
+   * @brief Retransmission timeout bounds, the lower bound must leave
+   * room for the peer to delay its ack by up to kMaxAckDelayMs
    *
    */
-  static constexpr double kStopSendingAcksTimeoutSec = static_cast<double>(Manager::kFinishSendingAllMsgsMs + 250 + 100) / 1000.0;
+  static constexpr std::chrono::milliseconds kInitialRto{100};
+  static constexpr std::chrono::milliseconds kMinRto{Manager::kMaxAckDelayMs + 10};
+  static constexpr std::chrono::milliseconds kMaxRto{2000};
 
   /**
-   * @brief Give 20 cycles before forgetting about having received this messages 
-   * 
+   * @brief Per link retransmission timeout (RFC 6298), fed only with samples
+   * of messages that were transmitted once (Karn's rule)
+   *
    */
-  static constexpr double kRemoveFromDelivered = kStopSendingAcksTimeoutSec * 20; 
+  class RttEstimator
+  {
+  private:
+    bool measured_{false};
+    Clock::duration srtt_{0};
+    Clock::duration rttvar_{0};
+    Clock::duration rto_{kInitialRto};
+
+  public:
+    void Sample(Clock::duration rtt) noexcept;
+
+    /**
+     * @brief Doubles the timeout after a retransmission
+     *
+     */
+    void Backoff() noexcept;
+
+    [[nodiscard]] inline Clock::duration rto() const noexcept
+    {
+      return rto_;
+    }
+
+    [[nodiscard]] inline Clock::duration srtt() const noexcept
+    {
+      return srtt_;
+    }
+  };
+
+  /**
+   * @brief Congestion window bounds, in datagrams of the client's mtu (RFC 6928)
+   *
+   */
+  static constexpr double kInitialCwnd = 10;
+  static constexpr double kMinCwnd = 2;
+  static constexpr double kMaxCwnd = 4096;
+
+  /**
+   * @brief Per link AIMD congestion window in bytes of frames: slow start
+   * doubles it every round trip up to the threshold, then it grows by
+   * one datagram per round trip, and every loss event halves it
+   *
+   */
+  class CongestionWindow
+  {
+  private:
+    const double mss_;
+    double cwnd_;
+    double ssthresh_;
+
+  public:
+    explicit CongestionWindow(std::size_t mss) noexcept
+        : mss_(static_cast<double>(mss)), cwnd_(kInitialCwnd * mss_), ssthresh_(kMaxCwnd * mss_) {}
+
+    void OnAck(std::size_t bytes_acked) noexcept;
+    void OnLoss() noexcept;
+
+    [[nodiscard]] inline double size() const noexcept
+    {
+      return cwnd_;
+    }
+  };
+
+public: // The send queue is public so bench/ can measure it on its own
+  /**
+   * @brief A message waiting for its ack, once admitted into the window it
+   * has a timer in retransmits_ for its deadline, a timer firing for an older
+   * deadline is stale. The deadline is Clock::time_point::min() while it is
+   * due right away, either never sent or detected lost
+   *
+   */
+  struct Outgoing
+  {
+    Clock::time_point sent_at;
+    Clock::time_point deadline{Clock::time_point::min()};
+    unsigned int transmissions{0};
+
+    SharedPayload payload; // Inline, or shared with the other links sending the same broadcast
+
+    /**
+     * @brief Size of the frame carrying this message
+     *
+     */
+    [[nodiscard]] inline std::size_t frame_size() const noexcept
+    {
+      return kMsgFrameHeaderSize + payload.size();
+    }
+  };
+
+  /**
+   * @brief Messages not yet acknowledged by the peer, in a power of two ring
+   * of slots indexed by seq and a bitmap of the live ones:
+   * [base, next_unsent) are in flight, those not live were acknowledged,
+   * [next_unsent, end) are queued, those not live are still being pushed
+   *
+   */
+  class OutboundQueue
+  {
+  private:
+    static constexpr std::size_t kWordBits = sizeof(std::uint64_t) * 8;
+
+    Message::Seq base_{1};
+    Message::Seq next_unsent_{1};
+    Message::Seq end_{1};
+    std::size_t size_{0};
+
+    std::size_t mask_;
+    std::vector<Outgoing> slots_;
+    std::vector<std::uint64_t> live_;
+
+  public:
+    OutboundQueue() noexcept;
+
+    void Push(Message::Seq seq, SharedPayload payload) noexcept;
+
+    /**
+     * @brief Moves the next queued message into flight, if it was pushed yet
+     *
+     * @return Outgoing* the admitted message or nullptr
+     */
+    Outgoing *Admit() noexcept;
+
+    /**
+     * @brief Whether Admit would return a message
+     *
+     */
+    [[nodiscard]] inline bool Admissible() const noexcept
+    {
+      return next_unsent_ != end_ && Live(next_unsent_);
+    }
+
+    /**
+     * @brief Only valid for live seqs
+     *
+     */
+    [[nodiscard]] inline Outgoing &at(Message::Seq seq) noexcept
+    {
+      return slots_[seq & mask_];
+    }
+
+    [[nodiscard]] inline const Outgoing &at(Message::Seq seq) const noexcept
+    {
+      return slots_[seq & mask_];
+    }
+
+    [[nodiscard]] bool InFlight(Message::Seq seq) const noexcept;
+
+    /**
+     * @brief First in flight seq at or after from, limit if there is none before it
+     *
+     */
+    [[nodiscard]] Message::Seq NextInFlight(Message::Seq from, Message::Seq limit) const noexcept;
+
+    void Erase(Message::Seq seq) noexcept;
+
+    [[nodiscard]] inline Message::Seq base() const noexcept
+    {
+      return base_;
+    }
+
+    [[nodiscard]] inline Message::Seq next_unsent() const noexcept
+    {
+      return next_unsent_;
+    }
+
+    [[nodiscard]] inline bool empty() const noexcept
+    {
+      return size_ == 0;
+    }
+
+  private:
+    [[nodiscard]] inline bool Live(Message::Seq seq) const noexcept
+    {
+      auto index = seq & mask_;
+      return (live_[index / kWordBits] >> (index % kWordBits)) & 1;
+    }
+
+    void Grow(std::size_t min_capacity) noexcept;
+  };
+
+private:
+  /**
+   * @brief Selective ack blocks sent per round, out of order messages
+   * past the last block are acknowledged once the window moves up
+   *
+   */
+  static constexpr std::size_t kMaxAckBlocks = 16;
+
+  /**
+   * @brief Messages received from the peer: every seq below the watermark
+   * was received and a bitmap covers the out of order ones above it
+   *
+   */
+  class ReceiveWindow
+  {
+  private:
+    SeqWindow received_;
+
+  public:
+    /**
+     * @brief Returns whether seq was unseen, seqs too far
+     * ahead are refused and get retransmitted later
+     *
+     */
+    inline bool Insert(Message::Seq seq) noexcept
+    {
+      return received_.Insert(seq);
+    }
+
+    /**
+     * @brief Writes at most max_blocks acks covering the window
+     *
+     * @return std::size_t number of acks written
+     */
+    std::size_t Acks(Ack *acks, std::size_t max_blocks) const noexcept;
+  };
 
 private:
   const Id id_;
@@ -129,9 +449,26 @@ private:
   UDPClient &client_;
   UDPServer &server_;
 
-  Shared<std::unordered_set<Ack>> acks_to_send_;
-  Shared<std::unordered_set<Message, Message::Hash>> messages_to_send_;
-  Shared<std::unordered_map<Message::Seq, std::time_t>> messages_delivered_;
+  std::atomic_bool ack_pending_{false};
+  std::atomic<Clock::rep> ack_pending_since_{0};
+
+  std::atomic<std::uint64_t> n_acks_piggybacked_{0};
+  std::atomic<std::uint64_t> n_acks_standalone_{0};
+
+  std::atomic<std::uint64_t> n_transmissions_{0};
+  std::atomic<std::uint64_t> n_retransmissions_{0};
+
+  // Guarded by messages_to_send_.mutex
+  RttEstimator rtt_;
+  CongestionWindow cwnd_;
+  TimerWheel retransmits_;
+  std::vector<TimerWheel::Key> expired_;
+  std::size_t bytes_in_flight_{0};
+  Message::Seq recovery_point_{1}; // The window shrinks once until acks reach it
+  Clock::time_point newest_acked_sent_at_; // Send time of the latest transmission known to have arrived
+
+  Shared<OutboundQueue> messages_to_send_;
+  Shared<ReceiveWindow> messages_delivered_;
 
   std::vector<Manager *> managers_;
 
@@ -152,18 +489,68 @@ public:
     return target_id_;
   }
 
+  /**
+   * @brief Payloads are expected to be at most kMaxPayloadSize bytes long
+   *
+   */
   Message::Seq Send(const std::string &msg) noexcept;
   Message::Seq Send(const char *payload, std::size_t len) noexcept;
 
+  /**
+   * @brief Holds on to the payload until it is acked, one
+   * that spilled to the heap is shared rather than copied
+   *
+   */
+  Message::Seq Send(const SharedPayload &payload) noexcept;
+
   void Subscribe(Manager *manager) noexcept;
 
+  [[nodiscard]] Stats stats() noexcept;
+
 private:
-  void SendAcks();
-  void CleanAcks() noexcept;
-  void SendMessages();
+  /**
+   * @brief Sends the pending ack if it can not wait any longer for
+   * outgoing messages to carry it
+   *
+   * @return std::optional<Clock::time_point> when to check again
+   */
+  std::optional<Clock::time_point> SendAcks(UDPClient::Batch &batch);
+
+  /**
+   * @brief Returns whether messages are still waiting for acks
+   *
+   */
+  bool SendMessages(UDPClient::Batch &batch);
+
+  /**
+   * @brief Appends the pending ack frames to the packet being built,
+   * transmitting it whenever it fills up
+   *
+   * @return std::size_t length of the packet being built
+   */
+  std::size_t PackAcks(UDPClient::Batch &batch, char *packet, std::size_t len) noexcept;
 
-  void Notify(const std::vector<char> &bytes) noexcept final;
+  void Transmit(UDPClient::Batch &batch, const char *packet, std::size_t len) noexcept;
 
-  static std::size_t Serialize(const Message &msg, char *buffer) noexcept;
-  static std::optional<std::variant<Message, Ack>> Parse(const std::vector<char> &bytes) noexcept;
+  void Notify(const PacketView &packet) noexcept final;
+  void NotifyMessage(const Message &message) noexcept;
+  void NotifyAck(const Ack &ack) noexcept;
+
+  /**
+   * @brief Marks messages left behind by a later transmission that
+   * already got acknowledged as lost, so they get sent on the next tick
+   *
+   */
+  void DetectLosses(Message::Seq highest_acked) noexcept;
+
+  static std::size_t Serialize(Message::Seq seq, const Outgoing &msg, char *buffer) noexcept;
+  static std::size_t Serialize(const Ack &ack, char *buffer) noexcept;
+
+  /**
+   * @brief Parses the frame starting at offset and advances
+   * offset past it, returns nothing once the datagram is exhausted
+   * or the frame is malformed
+   *
+   */
+  static std::optional<std::variant<Message, Ack>> Parse(const PacketView &packet, std::size_t &offset) noexcept;
 };
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Single threaded event loop on epoll: watched fds are drained
+ * when readable, and tickers run off a timerfd every kTickMs while any of
+ * them has timers pending. Once they are all idle the timer is disarmed
+ * and the loop sleeps until a fd is readable or Wake is called (eventfd).
+ *
+ */
+class Reactor
+{
+public:
+  class Handler
+  {
+    friend class Reactor;
+
+  protected:
+    virtual ~Handler() = default;
+
+    /**
+     * @brief The watched fd is readable, must not block
+     *
+     */
+    virtual void OnReadable() {}
+
+    /**
+     * @brief Runs the work that is due, must not block
+     *
+     * @return true if timers are still pending
+     */
+    virtual bool OnTick() { return false; }
+  };
+
+  static constexpr int kTickMs = 1;
+
+private:
+  static constexpr int kMaxEvents = 16;
+
+  int epollfd_;
+  int timerfd_;
+  int eventfd_;
+
+  std::atomic_bool on_{false};
+  std::atomic_bool idle_{false};
+  std::thread thread_;
+
+  bool timer_armed_{false};
+  std::vector<Handler *> tickers_;
+  std::vector<std::pair<int, Handler *>> watched_;
+
+public:
+  Reactor();
+
+  ~Reactor() noexcept;
+
+  Reactor(const Reactor &) = delete;
+  Reactor &operator=(const Reactor &) = delete;
+
+  /**
+   * @brief Must be called before Start
+   *
+   */
+  void Watch(int fd, Handler *handler);
+
+  /**
+   * @brief Must be called before Start
+   *
+   */
+  void AddTicker(Handler *handler) noexcept;
+
+  /**
+   * @brief Makes the loop tick soon, from any thread,
+   * only costs a syscall when the loop is asleep
+   *
+   */
+  void Wake() noexcept;
+
+  void Start() noexcept;
+
+  void Stop() noexcept;
+
+private:
+  void Run() noexcept;
+
+  void ArmTimer(bool armed) noexcept;
+};
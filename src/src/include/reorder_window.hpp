@@ -0,0 +1,84 @@
+#pragma once
+
+#include <set>
+#include <memory_resource>
+
+#include "seq_window.hpp"
+
+/**
+ * @brief Seqs of one author waiting for the ones before them. A fixed
+ * size SeqWindow holds the seqs close to the watermark as bits in a
+ * ring, and the rare seq that lands further out waits in an ordered
+ * overflow set until the watermark gets within reach of it.
+ *
+ */
+class ReorderWindow
+{
+public:
+  typedef SeqWindow::Seq Seq;
+
+  /**
+   * @brief Seqs that became in order, first to end (exclusive)
+   *
+   */
+  struct Run
+  {
+    Seq first;
+    Seq end;
+  };
+
+private:
+  SeqWindow window_;
+  std::pmr::set<Seq> overflow_;
+
+public:
+  /**
+   * @brief capacity is rounded up like SeqWindow's, the bitmap and the
+   * overflow set are allocated from resource
+   *
+   */
+  ReorderWindow(std::size_t capacity, std::pmr::memory_resource *resource) noexcept;
+
+  /**
+   * @brief Adds seq and returns the run it completed, an empty
+   * one if seq is a duplicate or leaves a gap before it
+   *
+   */
+  inline Run Insert(Seq seq)
+  {
+    // In order with nothing waiting, the window takes it without a scan
+    if (seq == window_.next() && size() == 0)
+    {
+      window_.Insert(seq);
+      return {seq, seq + 1};
+    }
+
+    return InsertOutOfOrder(seq);
+  }
+
+  [[nodiscard]] inline bool Contains(Seq seq) const noexcept
+  {
+    return window_.Contains(seq) || (!overflow_.empty() && overflow_.count(seq) > 0);
+  }
+
+  /**
+   * @brief Every seq below next is in order
+   *
+   */
+  [[nodiscard]] inline Seq next() const noexcept
+  {
+    return window_.next();
+  }
+
+  /**
+   * @brief Number of seqs waiting above the watermark
+   *
+   */
+  [[nodiscard]] inline std::size_t size() const noexcept
+  {
+    return window_.size() + overflow_.size();
+  }
+
+private:
+  Run InsertOutOfOrder(Seq seq);
+};
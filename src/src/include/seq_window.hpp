@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory_resource>
+
+/**
+ * @brief Set of sequence numbers that fill up in order: a watermark below
+ * which every seq is in the set, and a ring bitmap for the ones above it.
+ * Memory follows the reordering (highest seq - watermark), not the
+ * number of seqs ever inserted.
+ *
+ */
+class SeqWindow
+{
+public:
+  typedef unsigned int Seq;
+
+  static constexpr std::size_t kWordBits = sizeof(std::uint64_t) * 8;
+
+private:
+  const std::size_t max_capacity_;
+
+  Seq next_;
+  Seq end_;
+  std::size_t size_{0};
+
+  std::size_t mask_;
+  std::pmr::vector<std::uint64_t> words_;
+
+public:
+  /**
+   * @brief Seqs max_capacity or more past the watermark are refused,
+   * capacities are rounded up to powers of two of at least kWordBits
+   *
+   */
+  explicit SeqWindow(Seq first = 1, std::size_t capacity = kWordBits, std::size_t max_capacity = std::size_t{1} << 20,
+                     std::pmr::memory_resource *resource = std::pmr::get_default_resource()) noexcept;
+
+  /**
+   * @brief Returns whether seq was added, false if it was
+   * already in the set or too far past the watermark
+   *
+   */
+  inline bool Insert(Seq seq) noexcept
+  {
+    // In order with nothing above the watermark, the common case
+    if (seq == next_ && size_ == 0)
+    {
+      next_++;
+      end_ = next_;
+      return true;
+    }
+
+    return InsertAbove(seq);
+  }
+
+  [[nodiscard]] inline bool Contains(Seq seq) const noexcept
+  {
+    return seq < next_ || (seq < end_ && Test(seq));
+  }
+
+  /**
+   * @brief First seq in the set at or after from above the watermark,
+   * end() if there is none
+   *
+   */
+  [[nodiscard]] Seq NextAbove(Seq from) const noexcept;
+
+  /**
+   * @brief Every seq below next is in the set
+   *
+   */
+  [[nodiscard]] inline Seq next() const noexcept
+  {
+    return next_;
+  }
+
+  /**
+   * @brief One past the highest seq in the set
+   *
+   */
+  [[nodiscard]] inline Seq end() const noexcept
+  {
+    return end_;
+  }
+
+  /**
+   * @brief Number of seqs in the set above the watermark
+   *
+   */
+  [[nodiscard]] inline std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  /**
+   * @brief How far past the watermark a seq can be and still be inserted
+   *
+   */
+  [[nodiscard]] inline std::size_t max_capacity() const noexcept
+  {
+    return max_capacity_;
+  }
+
+private:
+  [[nodiscard]] inline bool Test(Seq seq) const noexcept
+  {
+    auto index = seq & mask_;
+    return (words_[index / kWordBits] >> (index % kWordBits)) & 1;
+  }
+
+  bool InsertAbove(Seq seq) noexcept;
+  void Advance() noexcept;
+  void Grow(std::size_t min_capacity) noexcept;
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <mutex>
+#include <utility>
+#include <shared_mutex>
 
 /**
  * @brief Generic struct for storing an assocatied shared_mutex
@@ -14,4 +16,7 @@ struct Shared
     T data;
 
     Shared() = default;
+
+    template <typename... Args>
+    explicit Shared(Args &&...args) : data(std::forward<Args>(args)...) {}
 };
\ No newline at end of file
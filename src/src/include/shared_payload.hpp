@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+// Payloads up to this many bytes live in the handle itself,
+// larger ones in a block shared by every copy of the handle
+#ifndef SHARED_PAYLOAD_INLINE_SIZE
+#define SHARED_PAYLOAD_INLINE_SIZE 16
+#endif
+
+/**
+ * @brief Immutable message bytes. Small payloads are stored inline and
+ * copied along with the handle, which never allocates. Larger ones spill
+ * to a reference counted block: a message broadcast to every peer is then
+ * copied once, and each link's outbound queue holds a reference until its
+ * peer acks it.
+ *
+ */
+class SharedPayload
+{
+public:
+  static constexpr std::size_t kInlineSize = SHARED_PAYLOAD_INLINE_SIZE;
+
+private:
+  struct Block
+  {
+    std::atomic<std::uint32_t> refs;
+    // The bytes follow
+  };
+
+  union Storage
+  {
+    Block *block;
+    char bytes[kInlineSize];
+  };
+
+  static_assert(kInlineSize >= sizeof(Block *), "SHARED_PAYLOAD_INLINE_SIZE must fit a pointer");
+
+  std::uint32_t size_{0};
+  Storage storage_{};
+
+public:
+  SharedPayload() noexcept = default;
+
+  SharedPayload(const char *bytes, std::size_t len);
+
+  SharedPayload(const SharedPayload &other) noexcept : size_(other.size_), storage_(other.storage_)
+  {
+    if (spilled())
+    {
+      storage_.block->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  SharedPayload(SharedPayload &&other) noexcept : size_(other.size_), storage_(other.storage_)
+  {
+    other.size_ = 0;
+  }
+
+  SharedPayload &operator=(SharedPayload other) noexcept
+  {
+    std::swap(size_, other.size_);
+    std::swap(storage_, other.storage_);
+    return *this;
+  }
+
+  ~SharedPayload() noexcept;
+
+  [[nodiscard]] inline const char *data() const noexcept
+  {
+    return spilled() ? reinterpret_cast<const char *>(storage_.block + 1) : storage_.bytes;
+  }
+
+  [[nodiscard]] inline std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  /**
+   * @brief Whether the bytes are on the heap, shared with the handle's copies
+   *
+   */
+  [[nodiscard]] inline bool spilled() const noexcept
+  {
+    return size_ > kInlineSize;
+  }
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Hierarchical timer wheel: kLevels wheels of kSlots slots each,
+ * level l slot s holds the timers whose tick differs from the current one
+ * only in digit l (base kSlots) and has that digit equal to s.
+ * Advancing only touches the slots passed by, timers get cascaded
+ * down a level at a time as their tick gets closer.
+ *
+ * Timers can not be cancelled, owners check whether an expired key
+ * is still relevant (and reschedule it if it fired too soon).
+ * Not thread safe, meant to be wrapped like any other shared state.
+ *
+ */
+class TimerWheel
+{
+public:
+  typedef std::uint64_t Key;
+  typedef std::uint64_t Tick;
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr unsigned int kSlotBits = 6;
+  static constexpr Tick kSlots = Tick{1} << kSlotBits;
+  static constexpr unsigned int kLevels = 4;
+
+  /**
+   * @brief Deadlines up to this many ticks away (16.7M, 4.6h at 1ms)
+   * are kept exact, further ones are clamped and fire early
+   *
+   */
+  static constexpr Tick kHorizon = Tick{1} << (kSlotBits * kLevels);
+
+private:
+  struct Timer
+  {
+    Key key;
+    Tick tick;
+  };
+
+  const Clock::time_point start_;
+  const Clock::duration resolution_;
+
+  Tick now_{0};
+  std::size_t size_{0};
+
+  std::vector<Key> due_; // Scheduled at or before the current tick
+  std::array<std::array<std::vector<Timer>, kSlots>, kLevels> slots_;
+
+public:
+  explicit TimerWheel(Clock::duration resolution = std::chrono::milliseconds(1),
+                      Clock::time_point start = Clock::now()) noexcept
+      : start_(start), resolution_(resolution) {}
+
+  /**
+   * @brief Key is handed back by the first Advance past deadline,
+   * never before it (unless deadline is beyond the horizon)
+   *
+   */
+  void Schedule(Key key, Clock::time_point deadline) noexcept;
+
+  /**
+   * @brief Appends every key whose deadline is at or before now to expired
+   *
+   */
+  void Advance(Clock::time_point now, std::vector<Key> &expired) noexcept;
+
+  /**
+   * @brief Whether a key for which live holds fires by deadline, so
+   * stale timers the owner will skip can be told apart. Only looks at
+   * the slots up to deadline, cheap for one close to now
+   *
+   */
+  template <typename Live>
+  [[nodiscard]] bool AnyDueBy(Clock::time_point deadline, Live &&live) const
+  {
+    for (const auto key : due_)
+    {
+      if (live(key))
+      {
+        return true;
+      }
+    }
+
+    if (deadline < start_ || size_ == due_.size())
+    {
+      return false;
+    }
+
+    const auto target = static_cast<Tick>((deadline - start_) / resolution_);
+
+    // Level l slots hold the ticks that share the digits above l with now,
+    // the ones past now's digit l are the next to come down
+    for (unsigned int level = 0; level < kLevels; level++)
+    {
+      const unsigned int shift = kSlotBits * level;
+      const Tick last = std::min(target >> shift, (now_ >> shift) | (kSlots - 1));
+
+      for (Tick digit = (now_ >> shift) + 1; digit <= last; digit++)
+      {
+        for (const auto &timer : slots_[level][digit & (kSlots - 1)])
+        {
+          if (timer.tick <= target && live(timer.key))
+          {
+            return true;
+          }
+        }
+      }
+    }
+
+    return false;
+  }
+
+  [[nodiscard]] inline std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+private:
+  void Place(const Timer &timer) noexcept;
+  void Cascade(unsigned int level) noexcept;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <memory_resource>
+
+/**
+ * @brief Memory resource of one bookkeeping structure: node allocations
+ * go to a pool of its own, or straight to the heap when pooling is off,
+ * and both levels are counted. The pool is unsynchronized, the structure
+ * must only allocate under its own lock.
+ *
+ */
+class TrackedResource final : public std::pmr::memory_resource
+{
+public:
+    struct Stats
+    {
+        std::uint64_t allocations{0};      // Requested by the structure
+        std::uint64_t heap_allocations{0}; // Made on its behalf, chunks of the pool when pooled
+        std::uint64_t peak_bytes{0};       // Requested and not yet released, at most
+    };
+
+private:
+    /**
+     * @brief Counts the calls that reach the heap
+     *
+     */
+    class Heap final : public std::pmr::memory_resource
+    {
+    public:
+        std::atomic<std::uint64_t> n_allocations{0};
+
+    private:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) final;
+        void do_deallocate(void *ptr, std::size_t bytes, std::size_t alignment) final;
+        [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept final;
+    };
+
+    Heap heap_;
+    std::optional<std::pmr::unsynchronized_pool_resource> pool_;
+    std::pmr::memory_resource *upstream_;
+
+    std::atomic<std::uint64_t> n_allocations_{0};
+    std::atomic<std::uint64_t> bytes_{0};
+    std::atomic<std::uint64_t> peak_bytes_{0};
+
+public:
+    explicit TrackedResource(bool pooled);
+
+    TrackedResource(const TrackedResource &) = delete;
+    TrackedResource &operator=(const TrackedResource &) = delete;
+
+    [[nodiscard]] inline bool pooled() const noexcept
+    {
+        return pool_.has_value();
+    }
+
+    [[nodiscard]] Stats stats() const noexcept;
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) final;
+    void do_deallocate(void *ptr, std::size_t bytes, std::size_t alignment) final;
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept final;
+};
@@ -1,27 +1,131 @@
 #pragma once
 
+#include <atomic>
 #include <string>
+#include <vector>
+#include <cstdint>
 #include <netdb.h>
+#include <sys/uio.h>
 #include <sys/types.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 
-class UDPServer;
+#include "udp_server.hpp"
+
+class UringTransport;
+
+// Number of datagrams handed to the kernel per sendmmsg call,
+// a batch of 1 falls back to one sendto per datagram
+#ifndef UDP_CLIENT_SEND_BATCH
+#define UDP_CLIENT_SEND_BATCH 64
+#endif
 
 class UDPClient
 {
+public:
+    static constexpr std::size_t kDefaultSendBatch = UDP_CLIENT_SEND_BATCH;
+    static constexpr std::size_t kMaxSendBatch = 1024;
+    static constexpr std::size_t kDefaultMtu = UDPServer::kMaxSendSize;
+
+    /**
+     * @brief Datagrams queued by a single thread, waiting to be
+     * flushed with one sendmmsg call. The storage is kept across
+     * flushes so that steady state queueing does not allocate.
+     *
+     */
+    class Batch
+    {
+        friend class UDPClient;
+
+    private:
+        const UDPClient *client_{nullptr};
+
+        std::size_t size_{0};
+        std::vector<char> bytes_;
+        std::vector<std::size_t> lens_;
+        std::vector<sockaddr_in> addrs_;
+        std::vector<iovec> iovecs_;
+        std::vector<mmsghdr> msgs_;
+
+    public:
+        [[nodiscard]] inline std::size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        /**
+         * @brief Flushes the batch through the client it was queued on
+         *
+         */
+        std::size_t Flush();
+
+    private:
+        void Push(const char *bytes, std::size_t len, sockaddr_in to_addr);
+    };
+
 private:
     int sockfd_;
     bool sock_owner_;
+    std::size_t send_batch_{kDefaultSendBatch};
+    std::size_t mtu_{kDefaultMtu};
+
+    UringTransport *transport_{nullptr};
+
+    mutable std::atomic<std::uint64_t> n_packets_sent_{0};
+    mutable std::atomic<std::uint64_t> n_send_calls_{0};
+    mutable std::atomic<std::uint64_t> n_bytes_sent_{0}; // UDP payload bytes, headers not included
 
 public:
     UDPClient();
 
-    explicit UDPClient(int sockfd, bool sock_owner = false);
+    explicit UDPClient(int sockfd,
+                       bool sock_owner = false,
+                       std::size_t send_batch = kDefaultSendBatch,
+                       std::size_t mtu = kDefaultMtu);
 
     ~UDPClient() noexcept;
 
     [[nodiscard]] ssize_t Send(const char *bytes, std::size_t len, sockaddr_in to_addr) const;
 
+    /**
+     * @brief Queues a datagram in the batch, then flushes
+     * the batch if it holds send_batch datagrams
+     *
+     */
+    void Queue(Batch &batch, const char *bytes, std::size_t len, sockaddr_in to_addr) const;
+
+    /**
+     * @brief Sends every queued datagram with as few
+     * sendmmsg calls as possible and empties the batch
+     *
+     * @return std::size_t number of datagrams sent
+     */
+    std::size_t Flush(Batch &batch) const;
+
+    /**
+     * @brief Batches are flushed through the transport instead of sendmmsg,
+     * from then on only the transport's thread may flush
+     *
+     */
+    void Use(UringTransport &transport) noexcept;
+
+    [[nodiscard]] std::size_t send_batch() const noexcept;
+
+    /**
+     * @brief Size senders should try to fill each datagram up to,
+     * never larger than UDPServer::kMaxSendSize
+     *
+     */
+    [[nodiscard]] std::size_t mtu() const noexcept;
+
+    [[nodiscard]] std::uint64_t n_packets_sent() const noexcept;
+
+    [[nodiscard]] std::uint64_t n_send_calls() const noexcept;
+
+    [[nodiscard]] std::uint64_t n_bytes_sent() const noexcept;
+
     static sockaddr_in Address(in_addr_t ip, unsigned short port) noexcept;
-};
\ No newline at end of file
+
+private:
+    std::size_t FlushTransport(Batch &batch) const;
+};
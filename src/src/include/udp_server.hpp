@@ -2,11 +2,14 @@
 
 #include <map>
 #include <list>
+#include <memory>
 #include <vector>
 #include <atomic>
 #include <thread>
 #include <string>
+#include <cstdint>
 #include <netdb.h>
+#include <sys/uio.h>
 #include <sys/types.h>
 #include <arpa/inet.h>
 #include <shared_mutex>
@@ -14,10 +17,29 @@
 #include <unordered_map>
 
 #include "shared.hpp"
+#include "reactor.hpp"
+#include "packet_pool.hpp"
 
-#define UDP_SERVER_MAX_MSG_SIZE 14
+// Largest datagram ever sent or received, a single packet
+// carries as many framed messages as fit under this size
+#ifndef UDP_SERVER_MAX_MSG_SIZE
+#define UDP_SERVER_MAX_MSG_SIZE 1472
+#endif
+
+// Number of datagrams pulled from the socket per recvmmsg call,
+// a batch of 1 falls back to the plain recvfrom loop
+#ifndef UDP_SERVER_RECV_BATCH
+#define UDP_SERVER_RECV_BATCH 64
+#endif
+
+// Number of SO_REUSEPORT sockets bound to the process port, each one
+// drained by its own thread and owning the peers steered to it
+#ifndef UDP_SERVER_RECV_SHARDS
+#define UDP_SERVER_RECV_SHARDS 1
+#endif
 
 class UDPClient;
+class UringTransport;
 
 struct Machine
 {
@@ -47,12 +69,14 @@ struct std::hash<Machine>
     {
         std::size_t h1 = std::hash<in_addr_t>{}(m.ip);
         std::size_t h2 = std::hash<in_port_t>{}(m.port);
-        return h1 ^ (h2 < 1);
+        return h1 ^ (h2 << 1);
     }
 };
 
-class UDPServer
+class UDPServer final
 {
+    friend class UringTransport;
+
 public:
     class Observer
     {
@@ -61,35 +85,189 @@ public:
     protected:
         virtual ~Observer() = default;
 
-        virtual void Notify(const std::vector<char> &bytes) = 0;
+        /**
+         * @brief The view is only valid for the duration of the call
+         *
+         */
+        virtual void Notify(const PacketView &packet) = 0;
     };
 
     static constexpr size_t kMaxSendSize = UDP_SERVER_MAX_MSG_SIZE;
+    static constexpr size_t kDefaultRecvBatch = UDP_SERVER_RECV_BATCH;
+    static constexpr size_t kMaxRecvBatch = 1024;
+    static constexpr size_t kDefaultRecvShards = UDP_SERVER_RECV_SHARDS;
+    static constexpr size_t kMaxRecvShards = 64;
+
+    /**
+     * @brief Receive calls per readable event on a reactor,
+     * leftovers wait for the next event so ticks are not starved
+     *
+     */
+    static constexpr size_t kMaxDrainCalls = 16;
+
+public: // The dispatch table is public so bench/ can measure it on its own
+    /**
+     * @brief Observers by machine, immutable once built: a perfect hash over
+     * the machines it holds (hash and displace, machines are grouped into
+     * buckets and each bucket gets the seed that places all of its machines
+     * in free slots), so a lookup is two hashes and one compare, with no lock
+     * and no allocation, in a table kept at most half full
+     *
+     */
+    class ObserverTable
+    {
+    private:
+        struct Slot
+        {
+            Machine machine{};
+            std::uint32_t begin{0};
+            std::uint32_t end{0}; // Empty slot when begin == end
+        };
+
+        static constexpr std::uint64_t kBucketSeed = 0x9e3779b97f4a7c15ULL;
+        static constexpr std::uint64_t kMaxSeedTries = 1 << 16;
+
+        std::size_t mask_{0};
+        std::size_t bucket_mask_{0};
+        std::vector<std::uint64_t> seeds_ = std::vector<std::uint64_t>(1);
+        std::vector<Slot> slots_ = std::vector<Slot>(1);
+        std::vector<Observer *> observers_;
+
+    public:
+        void Build(const std::unordered_map<Machine, std::vector<Observer *>> &observers);
+
+        /**
+         * @brief Observers of machine as a [begin, end) range, empty if unknown
+         *
+         */
+        [[nodiscard]] inline std::pair<Observer *const *, Observer *const *> Find(const Machine &machine) const noexcept
+        {
+            const auto seed = seeds_[Hash(machine, kBucketSeed) & bucket_mask_];
+            const Slot &slot = slots_[Hash(machine, seed) & mask_];
+            if (!(slot.machine == machine))
+            {
+                return {nullptr, nullptr};
+            }
+
+            return {observers_.data() + slot.begin, observers_.data() + slot.end};
+        }
+
+    private:
+        static inline std::uint64_t Hash(const Machine &machine, std::uint64_t seed) noexcept
+        {
+            // splitmix64 finalizer
+            std::uint64_t x = ((std::uint64_t{machine.ip} << 16) | machine.port) ^ seed;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+            return x ^ (x >> 31);
+        }
+    };
 
 private:
-    int sockfd_;
+    /**
+     * @brief A socket of the SO_REUSEPORT group with the thread that drains
+     * it. Every datagram from a peer lands on the same shard, which also
+     * holds that peer's observers, so a peer is only ever handled by one thread.
+     *
+     */
+    struct Shard final : public Reactor::Handler
+    {
+        UDPServer &server;
+        const int sockfd;
+
+        std::thread receive_thread;
+
+        std::vector<mmsghdr> recv_msgs;
+        std::vector<iovec> recv_iovecs;
+        std::vector<sockaddr_in> recv_addrs;
+        std::vector<PacketPool::Ref> recv_packets; // Received into in place and again, only ever read through views
+
+        std::atomic<std::uint64_t> n_packets_received{0};
+        std::atomic<std::uint64_t> n_receive_calls{0};
+
+        Shared<std::unordered_map<Machine, std::vector<Observer *>>> observers; // Filled by Attach
+        ObserverTable dispatch; // Built from observers on Start, read without locks
+
+        Shard(UDPServer &server, int sockfd);
+
+        void Receive() noexcept;
+
+        /**
+         * @brief One receive call, either recvfrom or recvmmsg
+         *
+         * @return std::size_t number of datagrams received
+         */
+        std::size_t ReceiveOnce(int flags) noexcept;
+
+        std::size_t ReceiveBatchOnce(int flags) noexcept;
+
+        void OnReadable() noexcept final;
+
+        void NotifyAll(std::size_t n_packets);
+    };
+
     sockaddr_in server_addr_;
     std::atomic_bool on_{false};
 
-    std::thread receive_thread_;
-
-    Shared<std::unordered_map<Machine, std::vector<Observer *>>> observers_;
+    const std::size_t recv_batch_;
+    PacketPool pool_{kMaxSendSize}; // Outlives the shards' packets
+    std::vector<std::unique_ptr<Shard>> shards_;
 
 public:
-    UDPServer(in_addr_t ip, in_port_t port);
+    UDPServer(in_addr_t ip,
+              in_port_t port,
+              std::size_t recv_batch = kDefaultRecvBatch,
+              std::size_t recv_shards = kDefaultRecvShards);
 
     ~UDPServer() noexcept = default;
 
     void Start() noexcept;
 
+    /**
+     * @brief Receives on the reactor's thread instead of threads of its own
+     *
+     */
+    void Start(Reactor &reactor);
+
     void Stop() noexcept;
 
+    /**
+     * @brief Must be called before Start, the dispatch tables are frozen then
+     *
+     */
     void Attach(Observer *obs, sockaddr_in addr) noexcept;
 
+    /**
+     * @brief Socket to send from, all shards share the address
+     *
+     */
     [[nodiscard]] int sockfd() const noexcept;
 
+    [[nodiscard]] std::size_t recv_batch() const noexcept;
+
+    [[nodiscard]] std::size_t recv_shards() const noexcept;
+
+    [[nodiscard]] std::uint64_t n_packets_received() const noexcept;
+
+    [[nodiscard]] std::uint64_t n_receive_calls() const noexcept;
+
+    [[nodiscard]] inline PacketPool &pool() noexcept
+    {
+        return pool_;
+    }
+
 private:
-    void Receive() noexcept;
+    /**
+     * @brief Same function as the steering program attached to the group
+     *
+     */
+    [[nodiscard]] Shard &ShardOf(const Machine &machine) const noexcept;
+
+    int OpenSocket(bool reuseport) const;
+
+    void AttachSteering() const;
+
+    void BuildDispatch();
 
-    void NotifyAll(const std::vector<char> &bytes, sockaddr_in addr);
+    void NotifyAll(const PacketView &packet, sockaddr_in addr);
 };
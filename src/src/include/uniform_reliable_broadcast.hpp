@@ -1,13 +1,43 @@
 #pragma once
 
+#include <cmath>
+#include <mutex>
 #include <queue>
+#include <memory_resource>
 
+#include "ack_table.hpp"
+#include "delay_window.hpp"
+#include "reorder_window.hpp"
+#include "tracked_resource.hpp"
 #include "best_effort_broadcast.hpp"
 
 // Considering the max load on the system will be 2 ** 21
 // total broadcast messages, lets try to batch that in 64 batches
 #define URB_MAX_MSGS_IN_NETWORK (1 << 15)
 
+// Queueing delay the own message window aims for, above
+// the smallest delivery latency seen lately
+#ifndef URB_OWN_WINDOW_TARGET_DELAY_MS
+#define URB_OWN_WINDOW_TARGET_DELAY_MS 25
+#endif
+
+// How long a smallest delivery latency is remembered for
+#ifndef URB_OWN_WINDOW_BASE_INTERVAL_MS
+#define URB_OWN_WINDOW_BASE_INTERVAL_MS 10000
+#endif
+
+// Delivered seqs past an author's watermark kept as bits, delivery
+// order follows the acks so it is about as reordered as FIFO's
+#ifndef URB_DELIVERED_WINDOW
+#define URB_DELIVERED_WINDOW 4096
+#endif
+
+// With digest acks, how long after receiving a message the
+// peers that have not acked it yet get the full message
+#ifndef URB_DIGEST_RELAY_AFTER_MS
+#define URB_DIGEST_RELAY_AFTER_MS 2000
+#endif
+
 /**
  * @brief
  * URB1 (aka RB1) Validity: If a correct process pi broadcasts a message m, then pi eventually delivers m.
@@ -19,72 +49,154 @@
  *
  * URB4 Uniform Agreement: If a message m is delivered by some process pi (whether correct or faulty), then m is also
  * eventually delivered by every correct process pj.
+ *
+ * Acks are either full relays, every process sending every message it receives on to all of its peers, or
+ * digests. With digests a process tells its peers which messages it has with packets of (author, seq) ranges,
+ * and only relays a message to the peers that still have not acked it URB_DIGEST_RELAY_AFTER_MS later, which
+ * is what keeps agreement when the author crashed halfway through broadcasting it.
  */
 class UniformReliableBroadcast : public BestEffortBroadcast
 {
     class DeliveredSet
     {
     private:
-        class PeerState
-        {
-        private:
-            Broadcast::Message::Id::Seq bottom_{1};
-            std::set<Broadcast::Message::Id::Seq> delivered_;
+        std::pmr::memory_resource *resource_;
+        PeerArray<ReorderWindow> state_; // Everything below an author's watermark was delivered
 
-        public:
-            inline std::size_t Size() const noexcept
-            {
-                return delivered_.size();
-            }
-
-            inline bool Contains(Broadcast::Message::Id::Seq seq) const noexcept
-            {
-                return seq < bottom_ || delivered_.count(seq);
-            }
+    public:
+        explicit DeliveredSet(std::pmr::memory_resource *resource) : resource_(resource) {}
 
-            void Insert(Broadcast::Message::Id::Seq seq) noexcept;
-        };
+        /**
+         * @brief Only called from Add, authors are never added on the receive path
+         *
+         */
+        inline void Reserve(PerfectLink::Id max_author)
+        {
+            state_.Resize(max_author, std::size_t{URB_DELIVERED_WINDOW}, resource_);
+        }
 
-    private:
-        std::unordered_map<PerfectLink::Id, PeerState> state_;
+        /**
+         * @brief Whether author is a process of the system, messages
+         * by anyone else are dropped before they become pending
+         *
+         */
+        [[nodiscard]] inline bool Knows(PerfectLink::Id author) const noexcept
+        {
+            return author != kDigestAuthor && state_.Contains(author);
+        }
 
-    public:
         inline bool Contains(const Broadcast::Message::Id &id) const noexcept
         {
-            if (state_.count(id.author))
-            {
-                return state_.at(id.author).Contains(id.seq);
-            }
-
-            return false;
+            return state_.Contains(id.author) && state_[id.author].Contains(id.seq);
         }
 
         inline void Insert(const Broadcast::Message::Id &id) noexcept
         {
-            state_[id.author].Insert(id.seq);
+            if (state_.Contains(id.author))
+            {
+                state_[id.author].Insert(id.seq);
+            }
         }
 
         std::size_t Size() const noexcept;
     };
 
 protected:
-    static constexpr int kFinishDeliveringAllMs = 100;
+    /**
+     * @brief A message is delivered by the ack that gives it a majority,
+     * on the thread that received it. Own messages also get a check when
+     * sent, for when no ack is needed, the deliver thread runs the checks
+     * that came due this often
+     *
+     */
+    static constexpr int kDeliverTickMs = 5;
 
 private:
     std::thread deliver_thread_;
+    std::mutex deliver_mutex_; // DeliverInternal runs on one thread at a time
+
+    /**
+     * @brief Own message held back until the window opens, messages
+     * only view their payload so this one keeps a copy
+     *
+     */
+    struct QueuedMessage
+    {
+        Broadcast::Message::Id::Seq seq;
+        SharedPayload payload;
+    };
+
+    // Digests travel as broadcast messages from this author, which is no process's id.
+    // The message's seq holds the number of ranges, each one (author, first seq, count).
+    static constexpr PerfectLink::Id kDigestAuthor = 0;
+    static constexpr std::size_t kDigestRangeSize = sizeof(PerfectLink::Id) + 2 * sizeof(Broadcast::Message::Id::Seq);
 
 protected:
     std::atomic_uint n_own_pending_for_delivery_{0};
     std::atomic_uint n_own_pending_delivery_ideal_{1};
 
-    Shared<DeliveredSet> delivered_;
-    Shared<std::queue<Broadcast::Message>> own_pending_for_broadcast_;
-    Shared<std::unordered_set<Broadcast::Message::Id>> pending_for_delivery_;
-    Shared<std::unordered_map<Message::Id, std::unordered_set<PerfectLink::Id>>> acks_;
+    // One per structure, each only allocates under the structure's lock
+    TrackedResource delivered_memory_;
+    TrackedResource pending_memory_;
+    TrackedResource acks_memory_;
+    TrackedResource sent_at_memory_;
+    TrackedResource relay_memory_;
+
+    Shared<DeliveredSet> delivered_{&delivered_memory_};
+    Shared<std::queue<QueuedMessage>> own_pending_for_broadcast_;
+    Shared<std::pmr::unordered_set<Broadcast::Message::Id>> pending_for_delivery_{&pending_memory_};
+    Shared<AckTable> acks_{&acks_memory_};
+    Shared<TimerWheel> delivery_checks_; // Keyed by ToKey(id)
+
+    const bool digest_acks_;
+    Shared<std::vector<Broadcast::Message::Id>> digest_pending_; // Received since the last digest went out
+    Shared<std::pmr::unordered_map<Broadcast::Message::Id, SharedPayload>> relay_payloads_{&relay_memory_}; // Serialized
+    Shared<TimerWheel> relay_checks_; // Keyed by ToKey(id), one per relay_payloads_ entry
+
+public:
+    struct Stats
+    {
+        std::size_t own_delivered;
+        double latency_ms; // Summed over own_delivered, from broadcast to delivery
+        unsigned int own_window;
+        double base_delay_ms; // Smallest recent delivery latency the window measures against
+        std::uint64_t digests;
+        std::uint64_t payload_relays; // Full messages sent to peers that had not acked them
+    };
+
+    typedef std::vector<std::pair<const char *, TrackedResource::Stats>> MemoryStats;
+
+private:
+    std::atomic<std::size_t> n_own_delivered_{0};
+    std::atomic<std::uint64_t> own_latency_us_{0};
+    std::atomic<std::uint64_t> own_base_delay_us_{0};
+    std::atomic<std::uint64_t> n_digests_{0};
+    std::atomic<std::uint64_t> n_payload_relays_{0};
+    Shared<std::pmr::unordered_map<Broadcast::Message::Id::Seq, TimerWheel::Clock::time_point>> own_sent_at_{&sent_at_memory_};
+
+    // Sizes n_own_pending_delivery_ideal_, only updated under own_sent_at_'s lock
+    DelayWindow own_window_{1,
+                            1,
+                            URB_MAX_MSGS_IN_NETWORK,
+                            std::chrono::milliseconds(URB_OWN_WINDOW_TARGET_DELAY_MS),
+                            std::chrono::milliseconds(URB_OWN_WINDOW_BASE_INTERVAL_MS)};
 
 public:
-    explicit UniformReliableBroadcast(Logger &logger, PerfectLink::Id id) noexcept
-        : BestEffortBroadcast(logger, id) {}
+    /**
+     * @brief With pooled, the per message bookkeeping is allocated
+     * from pools of its own rather than straight from the heap.
+     * With digest_acks, received messages are acked with digests
+     * rather than relayed.
+     *
+     */
+    explicit UniformReliableBroadcast(Logger &logger, PerfectLink::Id id, bool pooled = false, bool digest_acks = false)
+        : BestEffortBroadcast(logger, id),
+          delivered_memory_(pooled),
+          pending_memory_(pooled),
+          acks_memory_(pooled),
+          sent_at_memory_(pooled),
+          relay_memory_(pooled),
+          digest_acks_(digest_acks) {}
 
     ~UniformReliableBroadcast() noexcept override = default;
 
@@ -93,7 +205,10 @@ public:
         if (on_.load())
         {
             Broadcast::Stop();
-            deliver_thread_.join();
+            if (deliver_thread_.joinable())
+            {
+                deliver_thread_.join();
+            }
         }
     }
 
@@ -106,6 +221,44 @@ public:
         deliver_thread_ = std::thread(&UniformReliableBroadcast::DeliverPending, this);
     }
 
+    inline void Start(Reactor &reactor) noexcept override
+    {
+        Broadcast::Start(reactor);
+    }
+
+    [[nodiscard]] Stats urb_stats() const noexcept
+    {
+        return {n_own_delivered_.load(),
+                static_cast<double>(own_latency_us_.load()) / 1000.0,
+                n_own_pending_delivery_ideal_.load(),
+                static_cast<double>(own_base_delay_us_.load()) / 1000.0,
+                n_digests_.load(),
+                n_payload_relays_.load()};
+    }
+
+    [[nodiscard]] bool pooled() const noexcept
+    {
+        return acks_memory_.pooled();
+    }
+
+    [[nodiscard]] bool digest_acks() const noexcept
+    {
+        return digest_acks_;
+    }
+
+    /**
+     * @brief Allocations of each bookkeeping structure, by name
+     *
+     */
+    [[nodiscard]] virtual MemoryStats memory_stats() const noexcept
+    {
+        return {{"delivered", delivered_memory_.stats()},
+                {"pending_for_delivery", pending_memory_.stats()},
+                {"acks", acks_memory_.stats()},
+                {"own_sent_at", sent_at_memory_.stats()},
+                {"relay_payloads", relay_memory_.stats()}};
+    }
+
     void Add(std::unique_ptr<PerfectLink> pl) noexcept;
 
     void Send(const std::string &msg) noexcept;
@@ -116,6 +269,13 @@ protected:
         pending_for_delivery_.mutex.lock();
         pending_for_delivery_.data.insert(msg.id);
         pending_for_delivery_.mutex.unlock();
+        if (msg.id.author == id_)
+        {
+            own_sent_at_.mutex.lock();
+            own_sent_at_.data.emplace(msg.id.seq, TimerWheel::Clock::now());
+            own_sent_at_.mutex.unlock();
+        }
+        ScheduleDeliveryCheck(msg.id);
 #ifdef DEBUG
         std::cout << "[DBUG] URB: Actually broadcasting message " << msg.id.seq << " now\n";
 #endif
@@ -132,6 +292,72 @@ protected:
         }
     }
 
+    bool OnTick() noexcept override
+    {
+        bool busy = Broadcast::OnTick();
+        return DeliverDue() || busy;
+    }
+
 private:
     void DeliverPending() noexcept;
+
+    /**
+     * @brief Runs the delivery checks that came due,
+     * returns whether more are pending
+     *
+     */
+    bool DeliverDue() noexcept;
+
+    [[nodiscard]] inline bool MajorityAcked(std::size_t n_acks) const noexcept
+    {
+        return (n_acks + 1) > static_cast<std::size_t>(std::floor(n_processes_.load() / 2));
+    }
+
+    /**
+     * @brief Delivers a message that has a majority of acks, unless it already was
+     *
+     */
+    void Deliver(const Broadcast::Message::Id &id) noexcept;
+
+    /**
+     * @brief Broadcasts queued own messages while the window has room
+     *
+     */
+    void DrainOwnPending() noexcept;
+
+    /**
+     * @brief Acks msg in the next digest, and keeps it to relay
+     * to the peers that have not acked it by the time that is due
+     *
+     */
+    void QueueDigestAck(const Broadcast::Message &msg) noexcept;
+
+    void NotifyDigest(const Broadcast::Message &digest) noexcept;
+
+    /**
+     * @brief Sends the ids received since the last call as ranges
+     *
+     */
+    void SendDigests() noexcept;
+
+    /**
+     * @brief Relays the messages whose relay check came due
+     * to every peer that did not ack them
+     *
+     */
+    void RelayUnacked() noexcept;
+
+    void RecordOwnDelivery(Broadcast::Message::Id::Seq seq) noexcept;
+
+    void ScheduleDeliveryCheck(const Broadcast::Message::Id &id) noexcept;
+
+    static inline TimerWheel::Key ToKey(const Broadcast::Message::Id &id) noexcept
+    {
+        return (TimerWheel::Key{id.author} << 32) | id.seq;
+    }
+
+    static inline Broadcast::Message::Id FromKey(TimerWheel::Key key) noexcept
+    {
+        return {static_cast<Broadcast::Message::Id::Seq>(key), static_cast<PerfectLink::Id>(key >> 32)};
+    }
 };
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "io_uring.hpp"
+#include "reactor.hpp"
+#include "udp_server.hpp"
+
+// Receive buffers handed to the kernel (a power of two), each one
+// holds a datagram along with the header recvmsg writes in front of it
+#ifndef URING_TRANSPORT_RECV_BUFFERS
+#define URING_TRANSPORT_RECV_BUFFERS 512
+#endif
+
+// Registered send buffers, bounds the datagrams in flight at once
+#ifndef URING_TRANSPORT_SEND_SLOTS
+#define URING_TRANSPORT_SEND_SLOTS 512
+#endif
+
+// Zerocopy sends out of registered buffers, off by default as for datagrams
+// this small the notifications cost more than the copy they save
+#ifndef URING_TRANSPORT_ZEROCOPY
+#define URING_TRANSPORT_ZEROCOPY 0
+#endif
+
+/**
+ * @brief io_uring backend for the server's socket: a multishot recvmsg
+ * keeps filling kernel-selected buffers without a syscall per datagram,
+ * and the client's batches are copied into send slots that stay in flight
+ * until their completion, submitted with a single io_uring_enter.
+ * With URING_TRANSPORT_ZEROCOPY the slots are registered buffers sent from
+ * without a copy.
+ *
+ * What the kernel does not support is found out before the transport
+ * is used. No io_uring, no provided buffers, no multishot receive or no
+ * sends to an address (the last two came in 6.0) throw from the
+ * constructor, so the caller can stay on the socket path. No zerocopy
+ * falls back to plain sends at runtime.
+ *
+ * Runs on the reactor's thread, which must be the only one sending,
+ * and only drains the server's first socket: it takes a single shard.
+ *
+ */
+class UringTransport final : public Reactor::Handler
+{
+public:
+    static constexpr unsigned int kEntries = 1024;
+    static constexpr unsigned int kRecvBuffers = URING_TRANSPORT_RECV_BUFFERS;
+    static constexpr std::size_t kSendSlots = URING_TRANSPORT_SEND_SLOTS;
+    static constexpr std::size_t kRecvBufferSize = sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + UDPServer::kMaxSendSize;
+
+    static_assert((kRecvBuffers & (kRecvBuffers - 1)) == 0, "URING_TRANSPORT_RECV_BUFFERS must be a power of two");
+
+private:
+    // Low bit of user_data tells the two apart, sends carry their slot above it
+    static constexpr std::uint64_t kRecvTag = 0;
+    static constexpr std::uint64_t kSendTag = 1;
+
+    UDPServer &server_;
+    IoUring ring_;
+    Reactor *reactor_{nullptr};
+
+    bool zerocopy_{URING_TRANSPORT_ZEROCOPY != 0};
+    bool recv_armed_{false};
+
+    msghdr recv_msg_{};
+    std::vector<char> recv_buffers_;
+    io_uring_buf *buf_ring_{nullptr};
+    std::uint16_t buf_tail_{0};
+
+    std::vector<char> send_buffers_;
+    std::vector<sockaddr_in> send_addrs_;
+    std::vector<std::size_t> free_slots_;
+
+    std::vector<io_uring_cqe> deferred_; // Receives reaped while waiting on a send slot
+
+    std::uint64_t n_send_failures_{0};
+
+public:
+    /**
+     * @brief Throws if the kernel lacks what the transport needs
+     *
+     */
+    explicit UringTransport(UDPServer &server);
+
+    ~UringTransport() noexcept;
+
+    UringTransport(const UringTransport &) = delete;
+    UringTransport &operator=(const UringTransport &) = delete;
+
+    /**
+     * @brief Starts receiving, completions are reaped on the reactor's thread
+     *
+     */
+    void Start(Reactor &reactor);
+
+    /**
+     * @brief Copies the datagram into a send slot and queues its sqe
+     *
+     * @return false if it had to be dropped
+     */
+    bool Queue(const char *bytes, std::size_t len, sockaddr_in to_addr) noexcept;
+
+    /**
+     * @brief Hands every queued sqe to the kernel
+     *
+     */
+    void Submit() noexcept;
+
+    [[nodiscard]] inline bool zerocopy() const noexcept
+    {
+        return zerocopy_;
+    }
+
+    [[nodiscard]] inline std::uint64_t n_send_failures() const noexcept
+    {
+        return n_send_failures_;
+    }
+
+private:
+    void OnReadable() noexcept final;
+
+    bool OnTick() noexcept final;
+
+    void ArmRecv() noexcept;
+
+    /**
+     * @brief Arms the multishot receive and sends an empty datagram to
+     * the socket's own address, throws if the kernel refuses either
+     *
+     */
+    void Probe();
+
+    io_uring_sqe *GetSqe() noexcept;
+
+    /**
+     * @brief Waits for send completions until a slot is free,
+     * receives reaped meanwhile are deferred to the next tick
+     *
+     */
+    bool WaitForSlot() noexcept;
+
+    void Reap() noexcept;
+
+    void HandleRecv(const io_uring_cqe &cqe) noexcept;
+
+    void HandleSend(const io_uring_cqe &cqe) noexcept;
+
+    void RecycleBuffer(std::uint16_t bid) noexcept;
+
+    void PublishBuffers() noexcept;
+};
@@ -0,0 +1,95 @@
+#include "ack_table.hpp"
+
+#include <algorithm>
+
+AckTable::AckTable(std::pmr::memory_resource *resource) noexcept
+    : rows_(resource), words_(resource), free_rows_(resource) {}
+
+void AckTable::Reserve(Process max_process)
+{
+  std::size_t row_words = max_process / kWordBits + 1;
+  if (row_words <= row_words_)
+  {
+    return;
+  }
+
+  std::size_t n_rows = words_.size() / row_words_;
+  std::pmr::vector<std::uint64_t> words(n_rows * row_words, 0, words_.get_allocator());
+  for (std::size_t row = 0; row < n_rows; row++)
+  {
+    std::copy_n(words_.data() + row * row_words_, row_words_, words.data() + row * row_words);
+  }
+
+  words_.swap(words);
+  row_words_ = row_words;
+}
+
+std::size_t AckTable::Ack(const Key &key, Process process)
+{
+  Reserve(process);
+
+  auto [it, inserted] = rows_.try_emplace(key, 0);
+  if (inserted)
+  {
+    if (free_rows_.empty())
+    {
+      it->second = static_cast<std::uint32_t>(words_.size() / row_words_);
+      words_.resize(words_.size() + row_words_, 0);
+    }
+    else
+    {
+      it->second = free_rows_.back();
+      free_rows_.pop_back();
+    }
+  }
+
+  std::uint64_t *row = Row(it->second);
+  row[process / kWordBits] |= std::uint64_t{1} << (process % kWordBits);
+  return Count(row);
+}
+
+std::size_t AckTable::Count(const Key &key) const noexcept
+{
+  auto it = rows_.find(key);
+  if (it == rows_.end())
+  {
+    return 0;
+  }
+
+  return Count(words_.data() + it->second * row_words_);
+}
+
+bool AckTable::Contains(const Key &key, Process process) const noexcept
+{
+  auto it = rows_.find(key);
+  if (it == rows_.end() || process / kWordBits >= row_words_)
+  {
+    return false;
+  }
+
+  const std::uint64_t *row = words_.data() + it->second * row_words_;
+  return (row[process / kWordBits] >> (process % kWordBits)) & 1;
+}
+
+void AckTable::Erase(const Key &key)
+{
+  auto it = rows_.find(key);
+  if (it == rows_.end())
+  {
+    return;
+  }
+
+  std::fill_n(Row(it->second), row_words_, 0);
+  free_rows_.push_back(it->second);
+  rows_.erase(it);
+}
+
+std::size_t AckTable::Count(const std::uint64_t *row) const noexcept
+{
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < row_words_; i++)
+  {
+    count += static_cast<std::size_t>(__builtin_popcountll(row[i]));
+  }
+  return count;
+}
@@ -0,0 +1,57 @@
+#include "alloc_counter.hpp"
+
+#include <new>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+static std::atomic<std::uint64_t> n_allocations{0};
+
+std::uint64_t alloc_counter::n_allocations() noexcept
+{
+    return ::n_allocations.load(std::memory_order_relaxed);
+}
+
+// The array and nothrow forms of the standard library forward to these
+void *operator new(std::size_t size)
+{
+    n_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size != 0 ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    n_allocations.fetch_add(1, std::memory_order_relaxed);
+    // posix_memalign refuses alignments below that of a pointer, malloc already provides those
+    auto align = std::max(static_cast<std::size_t>(alignment), sizeof(void *));
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, align, size != 0 ? size : 1) == 0)
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
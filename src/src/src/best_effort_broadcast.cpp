@@ -5,19 +5,25 @@ void BestEffortBroadcast::SendInternal(const Broadcast::Message &msg) noexcept
     std::vector<PerfectLink *> pls;
 
     perfect_links_.mutex.lock_shared();
-    pls.reserve(perfect_links_.data.size());
-    for (const auto &[_, pl] : perfect_links_.data)
+    pls.reserve(perfect_links_.data.end_id());
+    for (const auto &pl : perfect_links_.data)
     {
-        pls.emplace_back(pl.get());
+        if (pl != nullptr)
+        {
+            pls.emplace_back(pl.get());
+        }
     }
     perfect_links_.mutex.unlock_shared();
 
-    static_assert(UDPServer::kMaxSendSize > PerfectLink::kPacketPrefixSize);
-    static_assert((UDPServer::kMaxSendSize - PerfectLink::kPacketPrefixSize) > kPacketPrefixSize);
+    static_assert(PerfectLink::kMaxPayloadSize > kPacketPrefixSize);
 
-    char buffer[UDPServer::kMaxSendSize - PerfectLink::kPacketPrefixSize];
+    char buffer[PerfectLink::kMaxPayloadSize];
     std::size_t len = Serialize(msg, buffer);
 
+    // Every link holds on to it until its peer acks, past the
+    // inline size the links share a single copy
+    const SharedPayload payload(buffer, len);
+
 #ifdef DEBUG
     if (msg.id.author == id_)
     {
@@ -27,7 +33,7 @@ void BestEffortBroadcast::SendInternal(const Broadcast::Message &msg) noexcept
 
     for (const auto pl : pls)
     {
-        pl->Send(buffer, len);
+        pl->Send(payload);
     }
 }
 
@@ -5,7 +5,7 @@
 void Broadcast::Send(const std::string &msg) noexcept
 {
     Message::Id::Seq seq = n_messages_sent_.fetch_add(1);
-    Message message = {{seq, id_}, id_, {msg.begin(), msg.end()}};
+    Message message = {{seq, id_}, id_, PacketView(msg)};
     LogSend(seq);
     SendInternal(message);
 }
@@ -35,6 +35,7 @@ void Broadcast::LogSend(const Message::Id::Seq seq) noexcept
 
 void Broadcast::LogDeliver(const Message::Id &id) noexcept
 {
+    n_delivered_.fetch_add(1, std::memory_order_relaxed);
     std::stringstream ss;
     ss << "d " << id.author << " " << id.seq;
     logger_ << ss.str();
@@ -51,9 +52,9 @@ std::size_t Broadcast::Serialize(const Broadcast::Message &msg, char *buffer) no
     return kPacketPrefixSize + msg.payload.size();
 }
 
-  std::optional<Broadcast::Message> Broadcast::Parse(PerfectLink::Id sender_id, const std::vector<char> &bytes) noexcept
+  std::optional<Broadcast::Message> Broadcast::Parse(PerfectLink::Id sender_id, const PacketView &packet) noexcept
   {
-    if (bytes.size() < kPacketPrefixSize)
+    if (packet.size() < kPacketPrefixSize)
     {
       return {};
     }
@@ -61,14 +62,10 @@ std::size_t Broadcast::Serialize(const Broadcast::Message &msg, char *buffer) no
     PerfectLink::Id aid;
     Message::Id::Seq seq;
 
-    std::vector<char> payload;
-    payload.reserve(bytes.size());
-
     auto aid_ptr = static_cast<char *>(static_cast<void *>(&aid));
     auto seq_ptr = static_cast<char *>(static_cast<void *>(&seq));
-    std::copy(bytes.begin(), bytes.begin() + sizeof(PerfectLink::Id), aid_ptr);
-    std::copy(bytes.begin() + sizeof(PerfectLink::Id), bytes.begin() + kPacketPrefixSize, seq_ptr);
-    std::copy(bytes.begin() + kPacketPrefixSize, bytes.end(), std::back_inserter(payload));
+    std::copy(packet.begin(), packet.begin() + sizeof(PerfectLink::Id), aid_ptr);
+    std::copy(packet.begin() + sizeof(PerfectLink::Id), packet.begin() + kPacketPrefixSize, seq_ptr);
 
-    return {{{seq, aid}, sender_id, payload}};
+    return {{{seq, aid}, sender_id, packet.Sub(kPacketPrefixSize, packet.size() - kPacketPrefixSize)}};
   }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "delay_window.hpp"
+
+#include <algorithm>
+
+DelayWindow::DelayWindow(double initial, double min, double max, Clock::duration target, Clock::duration base_interval) noexcept
+    : min_(min), max_(max), target_(target), base_interval_(base_interval), window_(std::clamp(initial, min, max)) {}
+
+void DelayWindow::OnCompletion(Clock::duration latency, std::size_t in_flight, Clock::time_point now) noexcept
+{
+  if (now - interval_start_ >= base_interval_)
+  {
+    previous_min_ = interval_min_;
+    interval_min_ = Clock::duration::max();
+    interval_start_ = now;
+  }
+  interval_min_ = std::min(interval_min_, latency);
+
+  recent_[n_samples_ % kFilterSize] = latency;
+  n_samples_++;
+
+  auto queueing = current_delay() - base_delay();
+  auto off_target = std::chrono::duration<double>(target_ - queueing) / std::chrono::duration<double>(target_);
+  off_target = std::clamp(off_target, -1.0, 1.0);
+
+  if (off_target > 0 && static_cast<double>(in_flight) < window_ / 2)
+  {
+    return;
+  }
+
+  // A window's worth of completions moves it by up to kGain of itself
+  window_ = std::clamp(window_ + kGain * off_target, min_, max_);
+}
+
+void DelayWindow::Resize(double window) noexcept
+{
+  window_ = std::clamp(window, min_, max_);
+}
+
+DelayWindow::Clock::duration DelayWindow::base_delay() const noexcept
+{
+  if (n_samples_ == 0)
+  {
+    return Clock::duration::zero();
+  }
+
+  return std::min(interval_min_, previous_min_);
+}
+
+DelayWindow::Clock::duration DelayWindow::current_delay() const noexcept
+{
+  if (n_samples_ == 0)
+  {
+    return Clock::duration::zero();
+  }
+
+  auto n = std::min(n_samples_, kFilterSize);
+  return *std::min_element(recent_.begin(), recent_.begin() + static_cast<std::ptrdiff_t>(n));
+}
@@ -1,13 +1,20 @@
 #include "drivers.hpp"
 
+#include <chrono>
 #include <iostream>
 
+#include "alloc_counter.hpp"
 #include "fifo_broadcast.hpp"
+#include "uring_transport.hpp"
 
 static std::optional<Logger> logger;
 static std::optional<UDPServer> server;
 static std::optional<UDPClient> client;
 static std::unique_ptr<PerfectLink::Manager> manager;
+static std::optional<UringTransport> transport;
+static std::optional<Reactor> reactor;
+static std::chrono::steady_clock::time_point start_time;
+static std::uint64_t allocations_at_start;
 
 [[noreturn]] static inline void WaitForever() noexcept
 {
@@ -17,8 +24,172 @@ static std::unique_ptr<PerfectLink::Manager> manager;
     }
 }
 
+static void DisplayStats() noexcept
+{
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    if (server.has_value())
+    {
+        auto n_packets = server.value().n_packets_received();
+        auto n_calls = server.value().n_receive_calls();
+        std::cout << "[INFO] UDPServer Stats (recv_batch = " << server.value().recv_batch() << ", recv_shards = " << server.value().recv_shards() << ")\n";
+        std::cout << "[INFO] ===========================\n";
+        std::cout << "[INFO] packets_received = " << n_packets << "\n";
+        std::cout << "[INFO] receive_calls = " << n_calls << "\n";
+        std::cout << "[INFO] packets_per_call = " << (n_calls > 0 ? static_cast<double>(n_packets) / static_cast<double>(n_calls) : 0.0) << "\n";
+        std::cout << "[INFO] packets_per_sec = " << (elapsed > 0 ? static_cast<double>(n_packets) / elapsed : 0.0) << "\n";
+    }
+
+    if (transport.has_value())
+    {
+        std::cout << "[INFO] io_uring Stats\n";
+        std::cout << "[INFO] ==============\n";
+        std::cout << "[INFO] zerocopy_send = " << transport.value().zerocopy() << "\n";
+        std::cout << "[INFO] send_failures = " << transport.value().n_send_failures() << "\n";
+    }
+
+    if (client.has_value())
+    {
+        auto n_packets = client.value().n_packets_sent();
+        auto n_calls = client.value().n_send_calls();
+        std::cout << "[INFO] UDPClient Stats (send_batch = " << client.value().send_batch() << ", mtu = " << client.value().mtu() << ")\n";
+        std::cout << "[INFO] ===========================\n";
+        std::cout << "[INFO] packets_sent = " << n_packets << "\n";
+        std::cout << "[INFO] send_calls = " << n_calls << "\n";
+        std::cout << "[INFO] packets_per_send_call = " << (n_calls > 0 ? static_cast<double>(n_packets) / static_cast<double>(n_calls) : 0.0) << "\n";
+        std::cout << "[INFO] packets_sent_per_sec = " << (elapsed > 0 ? static_cast<double>(n_packets) / elapsed : 0.0) << "\n";
+        std::cout << "[INFO] bytes_sent = " << client.value().n_bytes_sent() << "\n";
+        if (manager != nullptr)
+        {
+            auto n_delivered = manager->n_delivered();
+            std::cout << "[INFO] bytes_sent_per_delivered_message = " << (n_delivered > 0 ? static_cast<double>(client.value().n_bytes_sent()) / static_cast<double>(n_delivered) : 0.0) << "\n";
+        }
+    }
+
+    if (manager != nullptr)
+    {
+        auto stats = manager->stats();
+        auto n_acks = stats.acks_piggybacked + stats.acks_standalone;
+        std::cout << "[INFO] PerfectLink Stats\n";
+        std::cout << "[INFO] =================\n";
+        std::cout << "[INFO] acks_piggybacked = " << stats.acks_piggybacked << "\n";
+        std::cout << "[INFO] acks_standalone = " << stats.acks_standalone << "\n";
+        std::cout << "[INFO] acks_piggybacked_per_ack = " << (n_acks > 0 ? static_cast<double>(stats.acks_piggybacked) / static_cast<double>(n_acks) : 0.0) << "\n";
+        std::cout << "[INFO] transmissions = " << stats.transmissions << "\n";
+        std::cout << "[INFO] retransmissions = " << stats.retransmissions << "\n";
+        std::cout << "[INFO] retransmissions_per_transmission = " << (stats.transmissions > 0 ? static_cast<double>(stats.retransmissions) / static_cast<double>(stats.transmissions) : 0.0) << "\n";
+        std::cout << "[INFO] rto_ms_per_link = " << (stats.links > 0 ? stats.rto_ms / static_cast<double>(stats.links) : 0.0) << "\n";
+        std::cout << "[INFO] cwnd_bytes_per_link = " << (stats.links > 0 ? stats.cwnd_bytes / static_cast<double>(stats.links) : 0.0) << "\n";
+    }
+
+    if (manager != nullptr)
+    {
+        // Setup allocates the links and tables, only what the run allocated counts
+        auto n_allocations = alloc_counter::n_allocations() - allocations_at_start;
+        auto n_delivered = manager->n_delivered();
+        std::cout << "[INFO] Allocation Stats\n";
+        std::cout << "[INFO] ================\n";
+        std::cout << "[INFO] allocations = " << n_allocations << "\n";
+        std::cout << "[INFO] delivered = " << n_delivered << "\n";
+        std::cout << "[INFO] allocations_per_delivered_message = " << (n_delivered > 0 ? static_cast<double>(n_allocations) / static_cast<double>(n_delivered) : 0.0) << "\n";
+        std::cout << "[INFO] packet_buffers = " << (server.has_value() ? server.value().pool().n_allocated() : 0) << "\n";
+    }
+
+    if (auto urb = dynamic_cast<UniformReliableBroadcast *>(manager.get()))
+    {
+        auto stats = urb->urb_stats();
+        std::cout << "[INFO] UniformReliableBroadcast Stats\n";
+        std::cout << "[INFO] ==============================\n";
+        std::cout << "[INFO] own_delivered = " << stats.own_delivered << "\n";
+        std::cout << "[INFO] latency_ms_per_own_delivery = " << (stats.own_delivered > 0 ? stats.latency_ms / static_cast<double>(stats.own_delivered) : 0.0) << "\n";
+        std::cout << "[INFO] own_window_per_process = " << stats.own_window << "\n";
+        std::cout << "[INFO] base_delay_ms_per_process = " << stats.base_delay_ms << "\n";
+        std::cout << "[INFO] acks = " << (urb->digest_acks() ? "digest" : "relay") << "\n";
+        std::cout << "[INFO] digests = " << stats.digests << "\n";
+        std::cout << "[INFO] payload_relays = " << stats.payload_relays << "\n";
+    }
+
+    if (auto urb = dynamic_cast<UniformReliableBroadcast *>(manager.get()))
+    {
+        std::cout << "[INFO] Bookkeeping Memory Stats\n";
+        std::cout << "[INFO] ========================\n";
+        std::cout << "[INFO] allocator = " << (urb->pooled() ? "pool" : "heap") << "\n";
+        for (const auto &[name, stats] : urb->memory_stats())
+        {
+            std::cout << "[INFO] " << name << "_allocations = " << stats.allocations << "\n";
+            std::cout << "[INFO] " << name << "_heap_allocations = " << stats.heap_allocations << "\n";
+            std::cout << "[INFO] " << name << "_peak_bytes = " << stats.peak_bytes << "\n";
+        }
+    }
+}
+
+static std::size_t RecvShards(Parser &parser) noexcept
+{
+    auto shards = parser.recv_shards().value_or(UDPServer::kDefaultRecvShards);
+    if (parser.io_model() == Parser::kUring && shards > 1)
+    {
+        std::cout << "[INFO] io_uring drains a single socket, using one receive shard.\n";
+        return 1;
+    }
+
+    return shards;
+}
+
+static void StartAll(Parser &parser) noexcept
+{
+    allocations_at_start = alloc_counter::n_allocations();
+
+    if (parser.io_model() == Parser::kUring)
+    {
+        try
+        {
+            transport.emplace(server.value());
+        }
+        catch (const std::exception &e)
+        {
+            std::cout << "[INFO] " << e.what() << " Falling back to epoll.\n";
+        }
+    }
+
+    if (parser.io_model() != Parser::kThreads)
+    {
+        try
+        {
+            reactor.emplace();
+            if (transport.has_value())
+            {
+                transport.value().Start(reactor.value());
+                client.value().Use(transport.value());
+            }
+            else
+            {
+                server.value().Start(reactor.value());
+            }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << '\n';
+            std::exit(EXIT_FAILURE);
+        }
+
+        manager->Start(reactor.value());
+        reactor.value().Start();
+    }
+    else
+    {
+        server.value().Start();
+        manager->Start();
+    }
+}
+
 void drivers::StopExecution() noexcept
 {
+    if (reactor.has_value())
+    {
+        // Stop the event loop, it runs on behalf of the manager and server
+        reactor.value().Stop();
+    }
+
     if (manager != nullptr)
     {
         // Stop sending Messages
@@ -31,6 +202,8 @@ void drivers::StopExecution() noexcept
         server.value().Stop();
     }
 
+    DisplayStats();
+
     std::cout << "[INFO] Writing output." << std::endl;
 
     if (logger.has_value())
@@ -58,8 +231,14 @@ void drivers::PerfectLinks(Parser &parser) noexcept
     try
     {
         logger.emplace(parser.output_path(), false);
-        server.emplace(local_host.ip, local_host.port);
-        client.emplace(server.value().sockfd());
+        server.emplace(local_host.ip,
+                       local_host.port,
+                       parser.recv_batch().value_or(UDPServer::kDefaultRecvBatch),
+                       RecvShards(parser));
+        client.emplace(server.value().sockfd(),
+                       false,
+                       parser.send_batch().value_or(UDPClient::kDefaultSendBatch),
+                       parser.mtu().value_or(UDPClient::kDefaultMtu));
         manager = std::make_unique<PerfectLink::BasicManager>(logger.value());
     }
     catch (const std::exception &e)
@@ -68,10 +247,10 @@ void drivers::PerfectLinks(Parser &parser) noexcept
         std::exit(EXIT_FAILURE);
     }
 
+    start_time = std::chrono::steady_clock::now();
+
     if (id != target_host.id)
     {
-        server.value().Start();
-
         try
         {
             auto pl = std::make_unique<PerfectLink>(id,
@@ -88,7 +267,7 @@ void drivers::PerfectLinks(Parser &parser) noexcept
             std::exit(EXIT_FAILURE);
         }
 
-        manager->Start();
+        StartAll(parser);
 
         std::cout << "[INFO] Sending Messages\n";
         std::cout << "[INFO] ================" << std::endl;
@@ -104,8 +283,6 @@ void drivers::PerfectLinks(Parser &parser) noexcept
         std::cout << "[INFO] Receiving Messages\n";
         std::cout << "[INFO] ==================" << std::endl;
 
-        server.value().Start();
-
         for (const auto &peer : hosts)
         {
             if (id != peer.id)
@@ -128,7 +305,7 @@ void drivers::PerfectLinks(Parser &parser) noexcept
             }
         }
 
-        manager->Start();
+        StartAll(parser);
     }
 
     WaitForever();
@@ -151,9 +328,18 @@ void drivers::FIFOBroadcast(Parser &parser) noexcept
     try
     {
         logger.emplace(parser.output_path(), true);
-        server.emplace(local_host.ip, local_host.port);
-        client.emplace(server.value().sockfd());
-        manager = std::make_unique<UniformFIFOBroadcast>(logger.value(), id);
+        server.emplace(local_host.ip,
+                       local_host.port,
+                       parser.recv_batch().value_or(UDPServer::kDefaultRecvBatch),
+                       RecvShards(parser));
+        client.emplace(server.value().sockfd(),
+                       false,
+                       parser.send_batch().value_or(UDPClient::kDefaultSendBatch),
+                       parser.mtu().value_or(UDPClient::kDefaultMtu));
+        manager = std::make_unique<UniformFIFOBroadcast>(logger.value(),
+                                                         id,
+                                                         parser.alloc_model() == Parser::kPool,
+                                                         parser.ack_model() == Parser::kDigest);
     }
     catch (const std::exception &e)
     {
@@ -185,8 +371,8 @@ void drivers::FIFOBroadcast(Parser &parser) noexcept
         }
     }
 
-    server.value().Start();
-    fifo->Start();
+    start_time = std::chrono::steady_clock::now();
+    StartAll(parser);
 
     for (unsigned int i = 0; i < n_messages; ++i)
     {
@@ -2,79 +2,40 @@
 
 void ReliableFIFOBroadcast::DeliverInternal(const Broadcast::Message::Id &id, bool log) noexcept
 {
-    auto &state = peer_state_[id.author];
-
-    if (id.seq < state.next)
+    // Sized in Add, an author past it is not a process of the system
+    if (!peer_state_.Contains(id.author))
     {
         return;
     }
 
-    std::vector<Message::Id::Seq> to_remove;
-    to_remove.reserve(state.pending.size());
+    deliver_mutex_.lock();
+    const auto run = peer_state_[id.author].Insert(id.seq);
 
-    state.pending.insert(id.seq);
-    for (const auto seq : state.pending)
+    if (log)
     {
-        if (seq > state.next)
-        {
-            break;
-        }
-        else
+        for (auto seq = run.first; seq != run.end; seq++)
         {
-            if (seq > state.next)
-            {
-                break;
-            }
-
-            to_remove.emplace_back(seq);
-
-            if (log)
-            {
-                LogDeliver({seq, id.author});
-            }
-
-            state.next++;
+            LogDeliver({seq, id.author});
         }
     }
-
-    for (const auto seq : to_remove)
-    {
-        state.pending.erase(seq);
-    }
+    deliver_mutex_.unlock();
 }
 
 void UniformFIFOBroadcast::DeliverInternal(const Broadcast::Message::Id &id, bool log) noexcept 
 {
-    auto &state = peer_state_[id.author];
-
-    if (id.seq < state.next)
+    // The URB drops unknown authors before this, and both are sized in Add
+    if (!peer_state_.Contains(id.author))
     {
         return;
     }
 
-    std::vector<Message::Id::Seq> to_remove;
-    to_remove.reserve(state.pending.size());
+    const auto run = peer_state_[id.author].Insert(id.seq);
 
-    state.pending.insert(id.seq);
-    for (const auto seq : state.pending)
+    if (log)
     {
-        if (seq > state.next)
-        {
-            break;
-        }
-
-        to_remove.emplace_back(seq);
-
-        if (log)
+        for (auto seq = run.first; seq != run.end; seq++)
         {
             LogDeliver({seq, id.author});
         }
-
-        state.next++;
     }
-
-    for (const auto seq : to_remove)
-    {
-        state.pending.erase(seq);
-    }
-}
\ No newline at end of file
+}
@@ -0,0 +1,173 @@
+#include "io_uring.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+static void *Map(int fd, std::size_t size, off_t offset)
+{
+  void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+  if (ptr == MAP_FAILED)
+  {
+    throw std::runtime_error("Cannot map io_uring rings.");
+  }
+  return ptr;
+}
+
+template <typename T>
+static inline T *At(void *base, std::uint32_t offset) noexcept
+{
+  return reinterpret_cast<T *>(static_cast<char *>(base) + offset);
+}
+
+IoUring::IoUring(unsigned entries)
+{
+  fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params_));
+  if (fd_ < 0)
+  {
+    throw std::runtime_error("Cannot create io_uring.");
+  }
+
+  sq_ring_size_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+  sqes_size_ = params_.sq_entries * sizeof(io_uring_sqe);
+
+  try
+  {
+    if (params_.features & IORING_FEAT_SINGLE_MMAP)
+    {
+      sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+      sq_ring_ = Map(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+      cq_ring_ = sq_ring_;
+    }
+    else
+    {
+      sq_ring_ = Map(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+      cq_ring_ = Map(fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+    }
+
+    sqes_ = static_cast<io_uring_sqe *>(Map(fd_, sqes_size_, IORING_OFF_SQES));
+  }
+  catch (const std::exception &)
+  {
+    Unmap();
+    throw;
+  }
+
+  sq_head_ = At<unsigned>(sq_ring_, params_.sq_off.head);
+  sq_tail_ = At<unsigned>(sq_ring_, params_.sq_off.tail);
+  sq_array_ = At<unsigned>(sq_ring_, params_.sq_off.array);
+  sq_mask_ = *At<unsigned>(sq_ring_, params_.sq_off.ring_mask);
+  sq_local_tail_ = *sq_tail_;
+
+  cq_head_ = At<unsigned>(cq_ring_, params_.cq_off.head);
+  cq_tail_ = At<unsigned>(cq_ring_, params_.cq_off.tail);
+  cq_mask_ = *At<unsigned>(cq_ring_, params_.cq_off.ring_mask);
+  cqes_ = At<io_uring_cqe>(cq_ring_, params_.cq_off.cqes);
+}
+
+IoUring::~IoUring() noexcept
+{
+  Unmap();
+}
+
+void IoUring::Unmap() noexcept
+{
+  if (sqes_ != nullptr)
+  {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_)
+  {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr)
+  {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (fd_ >= 0)
+  {
+    close(fd_);
+  }
+
+  sqes_ = nullptr;
+  cq_ring_ = sq_ring_ = nullptr;
+  fd_ = -1;
+}
+
+io_uring_sqe *IoUring::GetSqe() noexcept
+{
+  unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (sq_local_tail_ - head >= params_.sq_entries)
+  {
+    return nullptr;
+  }
+
+  unsigned index = sq_local_tail_ & sq_mask_;
+  sq_array_[index] = index;
+  sq_local_tail_++;
+  to_submit_++;
+
+  io_uring_sqe *sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+int IoUring::Submit(unsigned wait_nr) noexcept
+{
+  // The kernel may only see the sqes once they are fully written
+  __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+
+  unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+  if (to_submit_ == 0 && flags == 0)
+  {
+    return 0;
+  }
+
+  auto res = static_cast<int>(syscall(__NR_io_uring_enter, fd_, to_submit_, wait_nr, flags, nullptr, 0));
+  if (res < 0)
+  {
+    return -errno;
+  }
+
+  to_submit_ -= std::min(to_submit_, static_cast<unsigned>(res));
+  return res;
+}
+
+io_uring_cqe *IoUring::PeekCqe() noexcept
+{
+  unsigned head = *cq_head_;
+  if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+  {
+    return nullptr;
+  }
+
+  return &cqes_[head & cq_mask_];
+}
+
+void IoUring::SeenCqe() noexcept
+{
+  __atomic_store_n(cq_head_, *cq_head_ + 1, __ATOMIC_RELEASE);
+}
+
+int IoUring::RegisterFiles(const int *fds, unsigned n) noexcept
+{
+  auto res = syscall(__NR_io_uring_register, fd_, IORING_REGISTER_FILES, fds, n);
+  return res < 0 ? -errno : 0;
+}
+
+int IoUring::RegisterBuffers(const iovec *iovecs, unsigned n) noexcept
+{
+  auto res = syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iovecs, n);
+  return res < 0 ? -errno : 0;
+}
+
+int IoUring::RegisterBufRing(io_uring_buf_reg &reg) noexcept
+{
+  auto res = syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1);
+  return res < 0 ? -errno : 0;
+}
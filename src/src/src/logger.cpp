@@ -1,6 +1,6 @@
 #include "logger.hpp"
 
-Logger::Logger(const std::string &fname, bool thread_safe)
+Logger::Logger(const std::string &fname, bool thread_safe) : thread_safe_(thread_safe)
 {
     std::ios::sync_with_stdio(thread_safe);
     file_.open(fname);
@@ -1,7 +1,9 @@
+#include <thread>
 #include <csignal>
 #include <cstring>
 #include <iostream>
 #include <optional>
+#include <signal.h>
 
 #include "parser.hpp"
 #include "drivers.hpp"
@@ -10,14 +12,20 @@
 
 /**
  * @brief Responsible for handling the
- * proper termination of the process
+ * proper termination of the process.
+ * Waits for the signals on a thread of its own, as a handler
+ * would run on top of whichever thread it interrupted, possibly
+ * one holding the locks (or malloc's) that stopping needs
  *
- * @param signum
+ * @param signals blocked in every other thread
  */
-static void stop_execution(int signum)
+[[noreturn]] static void stop_execution(sigset_t signals)
 {
-  signal(SIGINT, SIG_DFL);
-  signal(SIGTERM, SIG_DFL);
+  int signum = 0;
+  sigwait(&signals, &signum);
+
+  // A second signal kills the process if stopping hangs
+  pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
 
   std::cout << "\n[INFO] " << strsignal(signum) << " signal received.\n";
   std::cout << "[INFO] Immediately stopping network packet processing.\n";
@@ -29,8 +37,14 @@ static void stop_execution(int signum)
 
 int main(int argc, char *argv[])
 {
-  signal(SIGINT, stop_execution);
-  signal(SIGTERM, stop_execution);
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+
+  // Threads inherit the mask, so it has to be set before any is created
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  std::thread(stop_execution, signals).detach();
 
   Parser parser(argc, argv, true);
 
@@ -0,0 +1,46 @@
+#include "packet_pool.hpp"
+
+PacketPool::PacketPool(std::size_t capacity) : capacity_(capacity)
+{
+    // Releasing never allocates, it can run from any destructor
+    free_.reserve(PACKET_POOL_MAX_FREE);
+}
+
+PacketPool::~PacketPool() noexcept
+{
+    for (const auto buffer : free_)
+    {
+        delete buffer;
+    }
+}
+
+PacketPool::Ref PacketPool::Acquire()
+{
+    mutex_.lock();
+    if (!free_.empty())
+    {
+        Buffer *buffer = free_.back();
+        free_.pop_back();
+        mutex_.unlock();
+
+        buffer->size = 0;
+        return Ref(buffer);
+    }
+    mutex_.unlock();
+
+    n_allocated_.fetch_add(1, std::memory_order_relaxed);
+    return Ref(new Buffer{this, 0, std::make_unique<char[]>(capacity_)});
+}
+
+void PacketPool::Release(Buffer *buffer) noexcept
+{
+    mutex_.lock();
+    if (free_.size() < PACKET_POOL_MAX_FREE)
+    {
+        free_.push_back(buffer);
+        buffer = nullptr;
+    }
+    mutex_.unlock();
+
+    delete buffer;
+}
@@ -195,6 +195,41 @@ Parser::ExecMode Parser::exec_mode() const noexcept
     return exec_mode_;
 }
 
+Parser::IoModel Parser::io_model() const noexcept
+{
+    return io_model_;
+}
+
+Parser::AllocModel Parser::alloc_model() const noexcept
+{
+    return alloc_model_;
+}
+
+Parser::AckModel Parser::ack_model() const noexcept
+{
+    return ack_model_;
+}
+
+std::optional<std::size_t> Parser::recv_batch() const noexcept
+{
+    return recv_batch_;
+}
+
+std::optional<std::size_t> Parser::recv_shards() const noexcept
+{
+    return recv_shards_;
+}
+
+std::optional<std::size_t> Parser::send_batch() const noexcept
+{
+    return send_batch_;
+}
+
+std::optional<std::size_t> Parser::mtu() const noexcept
+{
+    return mtu_;
+}
+
 Parser::Host Parser::local_host() const
 {
     if ((id_ - 1) >= hosts_.size())
@@ -260,7 +295,7 @@ bool Parser::ParseInternal()
         return false;
     }
 
-    ParseMode();
+    ParseOptions();
 
     return true;
 }
@@ -296,30 +331,163 @@ bool Parser::ParseId() noexcept
     return false;
 }
 
-void Parser::ParseMode()
+void Parser::ParseOptions()
 {
-    if (argc_ < 10)
+    // Options follow the config path, or the output path without one
+    for (int i = requires_config_ ? 8 : 7; i < argc_; i += 2)
     {
-        return;
-    }
+        if (i + 1 == argc_)
+        {
+            throw std::runtime_error("Missing value for option `" + std::string(argv_[i]) + "`.");
+        }
 
-    if (std::strcmp(argv_[8], "--mode") == 0)
-    {
-        if (std::strcmp(argv_[9], "pl") == 0)
+        if (std::strcmp(argv_[i], "--mode") == 0)
+        {
+            ParseMode(argv_[i + 1]);
+        }
+        else if (std::strcmp(argv_[i], "--io") == 0)
+        {
+            ParseIo(argv_[i + 1]);
+        }
+        else if (std::strcmp(argv_[i], "--alloc") == 0)
+        {
+            ParseAlloc(argv_[i + 1]);
+        }
+        else if (std::strcmp(argv_[i], "--acks") == 0)
+        {
+            ParseAcks(argv_[i + 1]);
+        }
+        else if (std::strcmp(argv_[i], "--recv-batch") == 0)
         {
-            exec_mode_ = kPerfectLinks;
+            ParseRecvBatch(argv_[i + 1]);
         }
-        else if (std::strcmp(argv_[9], "fifo") == 0)
+        else if (std::strcmp(argv_[i], "--recv-shards") == 0)
         {
-            exec_mode_ = kFIFOBroadcast;
+            ParseRecvShards(argv_[i + 1]);
+        }
+        else if (std::strcmp(argv_[i], "--send-batch") == 0)
+        {
+            ParseSendBatch(argv_[i + 1]);
+        }
+        else if (std::strcmp(argv_[i], "--mtu") == 0)
+        {
+            ParseMtu(argv_[i + 1]);
         }
         else
         {
-            throw std::runtime_error("Invalid execution mode provided.");
+            throw std::runtime_error("Unknown option `" + std::string(argv_[i]) + "`.");
         }
     }
 }
 
+void Parser::ParseMode(const char *mode)
+{
+    if (std::strcmp(mode, "pl") == 0)
+    {
+        exec_mode_ = kPerfectLinks;
+    }
+    else if (std::strcmp(mode, "fifo") == 0)
+    {
+        exec_mode_ = kFIFOBroadcast;
+    }
+    else
+    {
+        throw std::runtime_error("Invalid execution mode provided.");
+    }
+}
+
+void Parser::ParseIo(const char *io)
+{
+    if (std::strcmp(io, "threads") == 0)
+    {
+        io_model_ = kThreads;
+    }
+    else if (std::strcmp(io, "epoll") == 0)
+    {
+        io_model_ = kEpoll;
+    }
+    else if (std::strcmp(io, "uring") == 0)
+    {
+        io_model_ = kUring;
+    }
+    else
+    {
+        throw std::runtime_error("Invalid io model provided.");
+    }
+}
+
+void Parser::ParseAlloc(const char *alloc)
+{
+    if (std::strcmp(alloc, "heap") == 0)
+    {
+        alloc_model_ = kHeap;
+    }
+    else if (std::strcmp(alloc, "pool") == 0)
+    {
+        alloc_model_ = kPool;
+    }
+    else
+    {
+        throw std::runtime_error("Invalid allocator provided.");
+    }
+}
+
+void Parser::ParseAcks(const char *acks)
+{
+    if (std::strcmp(acks, "relay") == 0)
+    {
+        ack_model_ = kRelay;
+    }
+    else if (std::strcmp(acks, "digest") == 0)
+    {
+        ack_model_ = kDigest;
+    }
+    else
+    {
+        throw std::runtime_error("Invalid ack model provided.");
+    }
+}
+
+void Parser::ParseRecvBatch(const char *recv_batch)
+{
+    if (!IsPositiveNumber(recv_batch) || std::stoul(recv_batch) == 0)
+    {
+        throw std::runtime_error("Invalid receive batch size provided.");
+    }
+
+    recv_batch_ = std::stoul(recv_batch);
+}
+
+void Parser::ParseRecvShards(const char *recv_shards)
+{
+    if (!IsPositiveNumber(recv_shards) || std::stoul(recv_shards) == 0)
+    {
+        throw std::runtime_error("Invalid number of receive shards provided.");
+    }
+
+    recv_shards_ = std::stoul(recv_shards);
+}
+
+void Parser::ParseSendBatch(const char *send_batch)
+{
+    if (!IsPositiveNumber(send_batch) || std::stoul(send_batch) == 0)
+    {
+        throw std::runtime_error("Invalid send batch size provided.");
+    }
+
+    send_batch_ = std::stoul(send_batch);
+}
+
+void Parser::ParseMtu(const char *mtu)
+{
+    if (!IsPositiveNumber(mtu) || std::stoul(mtu) == 0)
+    {
+        throw std::runtime_error("Invalid mtu provided.");
+    }
+
+    mtu_ = std::stoul(mtu);
+}
+
 bool Parser::ParseHostPath() noexcept
 {
     if (argc_ < 5)
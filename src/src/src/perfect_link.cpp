@@ -22,13 +22,26 @@ void PerfectLink::Manager::Start() noexcept
   send_thread_ = std::thread(&PerfectLink::Manager::SendMessages, this);
 }
 
+void PerfectLink::Manager::Start(Reactor &reactor) noexcept
+{
+  on_.store(true);
+  reactor_ = &reactor;
+  reactor.AddTicker(this);
+}
+
 void PerfectLink::Manager::Stop() noexcept
 {
   if (on_.load())
   {
     on_.store(false);
-    ack_thread_.join();
-    send_thread_.join();
+    if (ack_thread_.joinable())
+    {
+      ack_thread_.join();
+    }
+    if (send_thread_.joinable())
+    {
+      send_thread_.join();
+    }
   }
 }
 
@@ -37,6 +50,7 @@ void PerfectLink::Manager::Add(std::unique_ptr<PerfectLink> pl) noexcept
   const PerfectLink::Id id = pl->target_id();
 
   perfect_links_.mutex.lock();
+  perfect_links_.data.Resize(id);
   perfect_links_.data[id] = std::move(pl);
   perfect_links_.data[id]->Subscribe(this);
   perfect_links_.mutex.unlock();
@@ -46,53 +60,157 @@ void PerfectLink::Manager::Add(std::unique_ptr<PerfectLink> pl) noexcept
 
 void PerfectLink::Manager::SendAcks()
 {
+  UDPClient::Batch batch;
+
   while (on_.load())
   {
-    std::vector<PerfectLink *> pls;
+    SendDueAcks(batch);
+    Flush(batch);
+    std::this_thread::sleep_for(std::chrono::milliseconds(kAckDelayMs));
+  }
+}
 
-    perfect_links_.mutex.lock_shared();
-    pls.reserve(perfect_links_.data.size());
-    for (const auto &[_, pl] : perfect_links_.data)
+void PerfectLink::Manager::SendMessages()
+{
+  UDPClient::Batch batch;
+
+  while (on_.load())
+  {
+    SendDueMessages(batch);
+    Flush(batch);
+    std::this_thread::sleep_for(std::chrono::milliseconds(kSendTickMs));
+  }
+}
+
+bool PerfectLink::Manager::OnTick() noexcept
+{
+  bool busy = SendDueAcks(reactor_batch_);
+  busy = SendDueMessages(reactor_batch_) || busy;
+  Flush(reactor_batch_);
+  return busy;
+}
+
+bool PerfectLink::Manager::SendDueAcks(UDPClient::Batch &batch) noexcept
+{
+  // Only the links whose ack timer went off are visited
+  std::vector<TimerWheel::Key> expired;
+  ack_timers_.mutex.lock();
+  ack_timers_.data.Advance(Clock::now(), expired);
+  ack_timers_.mutex.unlock();
+
+  std::vector<PerfectLink *> pls;
+
+  perfect_links_.mutex.lock_shared();
+  pls.reserve(expired.size());
+  for (const auto id : expired)
+  {
+    if (perfect_links_.data.Contains(static_cast<Id>(id)) && perfect_links_.data[static_cast<Id>(id)] != nullptr)
     {
-      pls.push_back(pl.get());
+      pls.push_back(perfect_links_.data[static_cast<Id>(id)].get());
     }
-    perfect_links_.mutex.unlock_shared();
+  }
+  perfect_links_.mutex.unlock_shared();
 
-    for (const auto &pl : pls)
+  for (const auto &pl : pls)
+  {
+    if (auto retry = pl->SendAcks(batch))
     {
-      pl->SendAcks();
+      ScheduleAck(pl->target_id(), retry.value());
     }
-
-    std::this_thread::sleep_for(std::chrono::milliseconds(kFinishSendingAllAcksMs));
   }
+
+  ack_timers_.mutex.lock_shared();
+  bool pending = ack_timers_.data.size() > 0;
+  ack_timers_.mutex.unlock_shared();
+
+  return pending;
 }
 
-void PerfectLink::Manager::SendMessages()
+bool PerfectLink::Manager::SendDueMessages(UDPClient::Batch &batch) noexcept
 {
-  while (on_.load())
+  std::vector<PerfectLink *> pls;
+  perfect_links_.mutex.lock_shared();
+  pls.reserve(perfect_links_.data.end_id());
+  for (const auto &pl : perfect_links_.data)
   {
-    std::vector<PerfectLink *> pls;
-    perfect_links_.mutex.lock_shared();
-    pls.reserve(perfect_links_.data.size());
-    for (const auto &[_, pl] : perfect_links_.data)
+    if (pl != nullptr)
     {
       pls.push_back(pl.get());
     }
-    perfect_links_.mutex.unlock_shared();
+  }
+  perfect_links_.mutex.unlock_shared();
+
+  bool pending = false;
+  for (const auto pl : pls)
+  {
+    pending = pl->SendMessages(batch) || pending;
+  }
+
+  return pending;
+}
+
+void PerfectLink::Manager::Flush(UDPClient::Batch &batch) noexcept
+{
+  try
+  {
+    batch.Flush();
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << '\n';
+  }
+}
+
+void PerfectLink::Manager::Wake() noexcept
+{
+  if (reactor_ != nullptr)
+  {
+    reactor_->Wake();
+  }
+}
+
+void PerfectLink::Manager::ScheduleAck(Id id, Clock::time_point deadline) noexcept
+{
+  ack_timers_.mutex.lock();
+  ack_timers_.data.Schedule(id, deadline);
+  ack_timers_.mutex.unlock();
+
+  Wake();
+}
+
+PerfectLink::Stats PerfectLink::Manager::stats() noexcept
+{
+  Stats stats;
 
-    for (const auto pl : pls)
+  perfect_links_.mutex.lock_shared();
+  for (const auto &pl : perfect_links_.data)
+  {
+    if (pl != nullptr)
     {
-      pl->SendMessages();
+      stats += pl->stats();
     }
-
-    std::this_thread::sleep_for(std::chrono::milliseconds(kFinishSendingAllMsgsMs));
   }
+  perfect_links_.mutex.unlock_shared();
+
+  return stats;
+}
+
+PerfectLink::Stats &PerfectLink::Stats::operator+=(const Stats &other) noexcept
+{
+  acks_piggybacked += other.acks_piggybacked;
+  acks_standalone += other.acks_standalone;
+  transmissions += other.transmissions;
+  retransmissions += other.retransmissions;
+  rto_ms += other.rto_ms;
+  cwnd_bytes += other.cwnd_bytes;
+  links += other.links;
+  return *this;
 }
 
 void PerfectLink::BasicManager::Send(Id receiver_id, const std::string &msg) noexcept
 {
   perfect_links_.mutex.lock_shared();
-  if (perfect_links_.data.count(receiver_id))
+  if (perfect_links_.data.Contains(receiver_id) && perfect_links_.data[receiver_id] != nullptr)
   {
     Message::Seq id = perfect_links_.data[receiver_id]->Send(msg);
     std::stringstream ss;
@@ -104,6 +222,7 @@ void PerfectLink::BasicManager::Send(Id receiver_id, const std::string &msg) noe
 
 void PerfectLink::BasicManager::Notify(Id sender_id, const Message &msg) noexcept
 {
+  n_delivered_.fetch_add(1, std::memory_order_relaxed);
   std::stringstream ss;
   ss << "d " << sender_id << " " << msg.seq;
   logger_ << ss.str();
@@ -115,30 +234,36 @@ PerfectLink::PerfectLink(Id id,
                          in_port_t target_pot,
                          UDPServer &server,
                          UDPClient &client)
-    : id_(id), target_id_(target_id), target_addr_(UDPClient::Address(target_ip, target_pot)), client_(client), server_(server)
+    : id_(id), target_id_(target_id), target_addr_(UDPClient::Address(target_ip, target_pot)), client_(client), server_(server), cwnd_(client.mtu())
 {
   server_.Attach(this, target_addr_);
 }
 
 PerfectLink::Message::Seq PerfectLink::Send(const std::string &msg) noexcept
 {
-  Message::Seq id = n_messages_sent_.fetch_add(1);
-  messages_to_send_.mutex.lock();
-  messages_to_send_.data.insert({id, {msg.begin(), msg.end()}});
-  messages_to_send_.mutex.unlock();
-  return id;
+  return Send(msg.data(), msg.size());
 }
 
 PerfectLink::Message::Seq PerfectLink::Send(const char *payload, std::size_t len) noexcept
+{
+  return Send(SharedPayload(payload, len));
+}
+
+PerfectLink::Message::Seq PerfectLink::Send(const SharedPayload &payload) noexcept
 {
   Message::Seq id = n_messages_sent_.fetch_add(1);
 
   messages_to_send_.mutex.lock();
-  messages_to_send_.data.insert({id, {payload, payload + len}});
+  messages_to_send_.data.Push(id, payload);
   messages_to_send_.mutex.unlock();
 
+  for (const auto manager : managers_)
+  {
+    manager->Wake();
+  }
+
 #ifdef DEBUG
-  std::cout << "[DBUG] PerfectLink sending Raw Message of size (no metadata): " << len << "\n";
+  std::cout << "[DBUG] PerfectLink sending Raw Message of size (no metadata): " << payload.size() << "\n";
 #endif
 
   return id;
@@ -149,209 +274,632 @@ void PerfectLink::Subscribe(Manager *manager) noexcept
   managers_.emplace_back(manager);
 }
 
-void PerfectLink::SendAcks()
+PerfectLink::Stats PerfectLink::stats() noexcept
+{
+  Stats stats;
+  stats.links = 1;
+  stats.acks_piggybacked = n_acks_piggybacked_.load(std::memory_order_relaxed);
+  stats.acks_standalone = n_acks_standalone_.load(std::memory_order_relaxed);
+  stats.transmissions = n_transmissions_.load(std::memory_order_relaxed);
+  stats.retransmissions = n_retransmissions_.load(std::memory_order_relaxed);
+
+  messages_to_send_.mutex.lock_shared();
+  stats.rto_ms = std::chrono::duration<double, std::milli>(rtt_.rto()).count();
+  stats.cwnd_bytes = cwnd_.size();
+  messages_to_send_.mutex.unlock_shared();
+
+  return stats;
+}
+
+void PerfectLink::RttEstimator::Sample(Clock::duration rtt) noexcept
 {
-  acks_to_send_.mutex.lock_shared();
-  if (acks_to_send_.data.empty())
+  if (!measured_)
   {
-    acks_to_send_.mutex.unlock_shared();
-    return;
+    srtt_ = rtt;
+    rttvar_ = rtt / 2;
+    measured_ = true;
+  }
+  else
+  {
+    rttvar_ = (3 * rttvar_ + std::chrono::abs(srtt_ - rtt)) / 4;
+    srtt_ = (7 * srtt_ + rtt) / 8;
   }
 
-  for (auto ack_id : acks_to_send_.data)
+  rto_ = std::clamp<Clock::duration>(srtt_ + 4 * rttvar_, kMinRto, kMaxRto);
+}
+
+void PerfectLink::RttEstimator::Backoff() noexcept
+{
+  rto_ = std::min<Clock::duration>(2 * rto_, kMaxRto);
+}
+
+void PerfectLink::CongestionWindow::OnAck(std::size_t bytes_acked) noexcept
+{
+  auto acked = static_cast<double>(bytes_acked);
+
+  if (cwnd_ < ssthresh_)
+  {
+    cwnd_ += acked;
+  }
+  else
   {
-    static_assert(kPacketPrefixSize <= UDPServer::kMaxSendSize);
-    char buffer[kPacketPrefixSize];
+    cwnd_ += mss_ * acked / cwnd_;
+  }
 
-    PacketType pt{kACK};
-    auto pt_ptr = static_cast<char *>(static_cast<void *>(&pt));
-    std::copy(pt_ptr, pt_ptr + sizeof(PacketType), buffer);
+  cwnd_ = std::min(cwnd_, kMaxCwnd * mss_);
+}
 
-    auto id_ptr = static_cast<const char *>(static_cast<const void *>(&ack_id));
-    std::copy(id_ptr, id_ptr + sizeof(Message::Seq), buffer + sizeof(PacketType));
+void PerfectLink::CongestionWindow::OnLoss() noexcept
+{
+  ssthresh_ = std::max(cwnd_ / 2, kMinCwnd * mss_);
+  cwnd_ = ssthresh_;
+}
 
-    try
-    {
-      [[maybe_unused]] ssize_t bytes = client_.Send(buffer, kPacketPrefixSize, target_addr_);
-#ifdef DEBUG
-      std::cout << "[DBUG] Sending Ack " << ack_id << " To Process " << target_id_ << "\n";
-#endif
-    }
-    catch (const std::exception &e)
+PerfectLink::OutboundQueue::OutboundQueue() noexcept
+    : mask_(PERFECT_LINK_QUEUE_CAPACITY - 1), slots_(PERFECT_LINK_QUEUE_CAPACITY), live_(PERFECT_LINK_QUEUE_CAPACITY / kWordBits)
+{
+  static_assert(PERFECT_LINK_QUEUE_CAPACITY >= kWordBits && (PERFECT_LINK_QUEUE_CAPACITY & (PERFECT_LINK_QUEUE_CAPACITY - 1)) == 0,
+                "PERFECT_LINK_QUEUE_CAPACITY must be a power of two of at least 64");
+}
+
+void PerfectLink::OutboundQueue::Push(Message::Seq seq, SharedPayload payload) noexcept
+{
+  if (seq - base_ >= slots_.size())
+  {
+    Grow(seq - base_ + 1);
+  }
+
+  auto &msg = at(seq);
+  msg = Outgoing{};
+  msg.payload = std::move(payload);
+
+  auto index = seq & mask_;
+  live_[index / kWordBits] |= std::uint64_t{1} << (index % kWordBits);
+  end_ = std::max(end_, seq + 1);
+  size_++;
+}
+
+PerfectLink::Outgoing *PerfectLink::OutboundQueue::Admit() noexcept
+{
+  if (next_unsent_ == end_ || !Live(next_unsent_))
+  {
+    return nullptr;
+  }
+
+  return &at(next_unsent_++);
+}
+
+bool PerfectLink::OutboundQueue::InFlight(Message::Seq seq) const noexcept
+{
+  return seq >= base_ && seq < next_unsent_ && Live(seq);
+}
+
+PerfectLink::Message::Seq PerfectLink::OutboundQueue::NextInFlight(Message::Seq from, Message::Seq limit) const noexcept
+{
+  from = std::max(from, base_);
+  limit = std::min(limit, next_unsent_);
+
+  // A word never wraps around the ring, so seqs and bits advance together
+  while (from < limit)
+  {
+    auto index = from & mask_;
+    auto bits = live_[index / kWordBits] >> (index % kWordBits);
+
+    if (bits != 0)
     {
-      std::cerr << e.what() << '\n';
+      return std::min(limit, from + static_cast<Message::Seq>(__builtin_ctzll(bits)));
     }
+
+    from += static_cast<Message::Seq>(kWordBits - index % kWordBits);
   }
 
-  acks_to_send_.mutex.unlock_shared();
+  return limit;
+}
 
-  CleanAcks();
+void PerfectLink::OutboundQueue::Erase(Message::Seq seq) noexcept
+{
+  auto index = seq & mask_;
+  live_[index / kWordBits] &= ~(std::uint64_t{1} << (index % kWordBits));
+  size_--;
+
+  // Drop the reference now rather than when the slot is reused,
+  // the last link to get its ack frees the payload
+  at(seq).payload = SharedPayload();
+
+  if (seq == base_)
+  {
+    base_ = NextInFlight(base_ + 1, next_unsent_);
+  }
 }
 
-void PerfectLink::CleanAcks() noexcept
+void PerfectLink::OutboundQueue::Grow(std::size_t min_capacity) noexcept
 {
-  struct AckToRemove
+  std::size_t capacity = slots_.size();
+  while (capacity < min_capacity)
   {
-    Message::Seq seq;
-    bool remove_from_delivered;
-  };
+    capacity *= 2;
+  }
 
-  std::vector<AckToRemove> acks_to_remove;
+  std::vector<Outgoing> slots(capacity);
+  std::vector<std::uint64_t> live(capacity / kWordBits);
+  const std::size_t mask = capacity - 1;
 
-  messages_delivered_.mutex.lock_shared();
-  time_t now = std::time(nullptr);
-  for (const auto &msg : messages_delivered_.data)
+  for (Message::Seq seq = base_; seq != end_; ++seq)
   {
-    auto delta = std::difftime(now, msg.second);
-    if (delta >= kStopSendingAcksTimeoutSec)
+    if (Live(seq))
     {
-      acks_to_remove.push_back({msg.first, delta >= kRemoveFromDelivered});
+      auto index = seq & mask;
+      slots[index] = std::move(at(seq));
+      live[index / kWordBits] |= std::uint64_t{1} << (index % kWordBits);
     }
   }
 
-#ifndef PERFECT_LINKS_STRONG
-  for (const auto &ack_to_remove : acks_to_remove)
+  mask_ = mask;
+  slots_.swap(slots);
+  live_.swap(live);
+}
+
+std::size_t PerfectLink::ReceiveWindow::Acks(Ack *acks, std::size_t max_blocks) const noexcept
+{
+  static constexpr Message::Seq kBlockSize = sizeof(Ack::Bitmap) * 8;
+
+  const Message::Seq next = received_.next();
+  const Message::Seq end = received_.end();
+
+  std::size_t n_acks = 0;
+  Message::Seq seq = received_.NextAbove(next);
+
+  do
   {
-    if (ack_to_remove.remove_from_delivered)
+    Ack &ack = acks[n_acks++];
+    ack = {next, next, 0};
+
+    if (seq != end)
     {
-      messages_delivered_.data.erase(ack_to_remove.seq);
+      ack.base = seq;
+      for (; seq != end && seq - ack.base < kBlockSize; seq = received_.NextAbove(seq + 1))
+      {
+        ack.received |= Ack::Bitmap{1} << (seq - ack.base);
+      }
     }
+  } while (seq != end && n_acks < max_blocks);
+
+  return n_acks;
+}
+
+std::optional<PerfectLink::Clock::time_point> PerfectLink::SendAcks(UDPClient::Batch &batch)
+{
+  if (!ack_pending_.load())
+  {
+    return {};
   }
-#endif
 
-  messages_delivered_.mutex.unlock_shared();
+  auto pending_since = Clock::time_point(Clock::duration(ack_pending_since_.load()));
+  auto pending_for = Clock::now() - pending_since;
 
-  acks_to_send_.mutex.lock();
-  for (auto const &ack_to_remove : acks_to_remove)
+  if (pending_for < std::chrono::milliseconds(Manager::kAckDelayMs))
   {
-    acks_to_send_.data.erase({ack_to_remove.seq});
+    return pending_since + std::chrono::milliseconds(Manager::kAckDelayMs);
   }
-  acks_to_send_.mutex.unlock();
-}
 
-void PerfectLink::SendMessages()
-{
-  messages_to_send_.mutex.lock_shared();
+  // A message going out to the peer before the ack has waited for too long
+  // will carry it: one the window admits now, or one due for retransmission
+  auto carry_by = pending_since + std::chrono::milliseconds(Manager::kMaxAckDelayMs);
+  bool reverse_traffic = false;
 
-  if (messages_to_send_.data.empty())
+  if (pending_for < std::chrono::milliseconds(Manager::kMaxAckDelayMs))
   {
+    messages_to_send_.mutex.lock_shared();
+    const auto &queue = messages_to_send_.data;
+
+    // Timers are not cancelled, one for an acked or resent message is stale
+    auto due = [&](TimerWheel::Key key)
+    {
+      auto seq = static_cast<Message::Seq>(key);
+      return queue.InFlight(seq) && queue.at(seq).deadline <= carry_by;
+    };
+
+    bool admissible = queue.Admissible() && static_cast<double>(bytes_in_flight_) < cwnd_.size();
+    reverse_traffic = admissible || retransmits_.AnyDueBy(carry_by, due);
     messages_to_send_.mutex.unlock_shared();
-    return;
   }
 
-  for (auto &msg : messages_to_send_.data)
+  if (reverse_traffic)
   {
-    char buffer[UDPServer::kMaxSendSize];
-    std::size_t len = Serialize(msg, buffer);
+    return carry_by;
+  }
+
+  char packet[UDPServer::kMaxSendSize];
+  std::size_t len = PackAcks(batch, packet, 0);
+
+  if (len > 0)
+  {
+    n_acks_standalone_.fetch_add(1, std::memory_order_relaxed);
+    Transmit(batch, packet, len);
+  }
 
-    try
+  return {};
+}
+
+std::size_t PerfectLink::PackAcks(UDPClient::Batch &batch, char *packet, std::size_t len) noexcept
+{
+  // Only acknowledge when something arrived since the last ack,
+  // a lost ack is repaired by the ack of the retransmission
+  if (!ack_pending_.exchange(false))
+  {
+    return len;
+  }
+
+  Ack acks[kMaxAckBlocks];
+
+  messages_delivered_.mutex.lock_shared();
+  std::size_t n_acks = messages_delivered_.data.Acks(acks, kMaxAckBlocks);
+  messages_delivered_.mutex.unlock_shared();
+
+  static_assert(kAckFrameSize <= UDPServer::kMaxSendSize);
+
+  for (std::size_t i = 0; i < n_acks; ++i)
+  {
+    if (len > 0 && len + kAckFrameSize > client_.mtu())
     {
-      [[maybe_unused]] ssize_t bytes = client_.Send(buffer, kPacketPrefixSize + msg.payload.size(), target_addr_);
+      Transmit(batch, packet, len);
+      len = 0;
+    }
+
+    len += Serialize(acks[i], packet + len);
 #ifdef DEBUG
-      std::cout << "[DBUG] Sending Message " << msg.seq << " To Process " << target_id_ << "\n";
+    std::cout << "[DBUG] Sending Ack " << acks[i].next << " To Process " << target_id_ << "\n";
 #endif
-    }
-    catch (const std::exception &e)
-    {
-      std::cerr << e.what() << '\n';
-    }
   }
 
-  messages_to_send_.mutex.unlock_shared();
+  return len;
 }
 
-void PerfectLink::Notify(const std::vector<char> &bytes) noexcept
+bool PerfectLink::SendMessages(UDPClient::Batch &batch)
 {
-  auto parsed_packet = Parse(bytes);
+  const auto now = Clock::now();
+
+  messages_to_send_.mutex.lock();
 
-  if (!parsed_packet.has_value())
+  auto &queue = messages_to_send_.data;
+
+  // Queued messages enter the window in order as acks make room, due right away
+  while (static_cast<double>(bytes_in_flight_) < cwnd_.size())
   {
-#ifdef DEBUG
-    std::cout << "[DBUG] Invalid Perfect Links Message received.\n";
-#endif
-    return;
+    auto msg = queue.Admit();
+    if (msg == nullptr)
+    {
+      break;
+    }
+
+    bytes_in_flight_ += msg->frame_size();
+    retransmits_.Schedule(queue.next_unsent() - 1, Clock::time_point::min());
+  }
+
+  retransmits_.Advance(now, expired_);
+
+  if (expired_.empty())
+  {
+    bool pending = !queue.empty();
+    messages_to_send_.mutex.unlock();
+    return pending;
+  }
+
+  // Frames go out in seq order, whatever order the slots fired in
+  std::sort(expired_.begin(), expired_.end());
+
+  char packet[UDPServer::kMaxSendSize];
+  std::size_t len = 0;
+
+  // The pending ack rides at the head of the first datagram
+  if (ack_pending_.load())
+  {
+    len = PackAcks(batch, packet, len);
+    if (len > 0)
+    {
+      n_acks_piggybacked_.fetch_add(1, std::memory_order_relaxed);
+    }
   }
 
-  if (parsed_packet.value().index() == 0)
+  bool backed_off = false;
+
+  for (const auto key : expired_)
   {
-    // Received a Message
-    Message message = std::get<0>(parsed_packet.value());
+    auto seq = static_cast<Message::Seq>(key);
 
-    acks_to_send_.mutex.lock();
-    acks_to_send_.data.insert({message.seq});
-    acks_to_send_.mutex.unlock();
+    // Acknowledged since the timer was set
+    if (!queue.InFlight(seq))
+    {
+      continue;
+    }
 
-    messages_delivered_.mutex.lock();
-    bool unseen = messages_delivered_.data.find(message.seq) == messages_delivered_.data.end();
-    messages_delivered_.mutex.unlock();
+    auto &msg = queue.at(seq);
 
-    if (unseen)
+    // Resent since the timer was set
+    if (msg.deadline > now)
     {
-      // Its an unseen message
-      for (const auto manager : managers_)
+      continue;
+    }
+
+    if (msg.transmissions > 0)
+    {
+      n_retransmissions_.fetch_add(1, std::memory_order_relaxed);
+
+      // Like the single retransmission timer of TCP, only the oldest
+      // message timing out counts as a loss event
+      bool timed_out = msg.deadline != Clock::time_point::min();
+      if (timed_out && !backed_off && seq == queue.base())
       {
-        manager->Notify(target_id_, message);
+        rtt_.Backoff();
+        cwnd_.OnLoss();
+        recovery_point_ = queue.next_unsent();
+        backed_off = true;
       }
     }
 
-    messages_delivered_.mutex.lock();
-    messages_delivered_.data[message.seq] = std::time(nullptr);
-    messages_delivered_.mutex.unlock();
+    // Frames are never split, one larger than the mtu travels alone
+    if (len > 0 && len + msg.frame_size() > client_.mtu())
+    {
+      Transmit(batch, packet, len);
+      len = 0;
+    }
+
+    len += Serialize(seq, msg, packet + len);
+#ifdef DEBUG
+    std::cout << "[DBUG] Sending Message " << seq << " To Process " << target_id_ << "\n";
+#endif
+
+    msg.sent_at = now;
+    msg.deadline = now + rtt_.rto();
+    msg.transmissions++;
+    n_transmissions_.fetch_add(1, std::memory_order_relaxed);
+    retransmits_.Schedule(seq, msg.deadline);
   }
-  else
+
+  if (len > 0)
   {
-    // Received an Ack
-    Ack ack_id = std::get<1>(parsed_packet.value());
+    Transmit(batch, packet, len);
+  }
+
+  expired_.clear();
+  bool pending = !queue.empty();
+  messages_to_send_.mutex.unlock();
 
+  return pending;
+}
+
+void PerfectLink::Transmit(UDPClient::Batch &batch, const char *packet, std::size_t len) noexcept
+{
+  try
+  {
+    client_.Queue(batch, packet, len, target_addr_);
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << '\n';
+  }
+}
+
+void PerfectLink::Notify(const PacketView &packet) noexcept
+{
+  std::size_t offset = 0;
+
+  while (offset < packet.size())
+  {
+    auto parsed_frame = Parse(packet, offset);
+
+    if (!parsed_frame.has_value())
+    {
 #ifdef DEBUG
-    std::cout << "[DBUG] Received Ack for Message " << ack_id << "\n";
+      std::cout << "[DBUG] Invalid Perfect Links Message received.\n";
 #endif
+      return;
+    }
 
-    messages_to_send_.mutex.lock();
-    auto message = messages_to_send_.data.find(Message{ack_id, {}});
-    if (message != messages_to_send_.data.end())
+    if (parsed_frame.value().index() == 0)
     {
+      NotifyMessage(std::get<0>(parsed_frame.value()));
+    }
+    else
+    {
+      NotifyAck(std::get<1>(parsed_frame.value()));
+    }
+  }
+}
+
+void PerfectLink::NotifyMessage(const Message &message) noexcept
+{
+  messages_delivered_.mutex.lock();
+  bool unseen = messages_delivered_.data.Insert(message.seq);
+  messages_delivered_.mutex.unlock();
+
+  if (!ack_pending_.exchange(true))
+  {
+    auto now = Clock::now();
+    ack_pending_since_.store(now.time_since_epoch().count());
+
+    for (const auto manager : managers_)
+    {
+      manager->ScheduleAck(target_id_, now + std::chrono::milliseconds(Manager::kAckDelayMs));
+    }
+  }
+
+  if (unseen)
+  {
+    // Its an unseen message
+    for (const auto manager : managers_)
+    {
+      manager->Notify(target_id_, message);
+    }
+  }
+}
+
+void PerfectLink::NotifyAck(const Ack &ack) noexcept
+{
 #ifdef DEBUG
-      std::cout << "[DBUG] Successfully Sent Message " << ack_id << " To Process " << target_id_ << "\n";
+  std::cout << "[DBUG] Received Ack for Messages up to " << ack.next << "\n";
 #endif
-      // If we were sending this message,
-      // then stop sending it peer has received
-      messages_to_send_.data.erase({ack_id, {}});
+
+  const auto now = Clock::now();
+  auto last_sent = Clock::time_point::min();
+  std::size_t bytes_acked = 0;
+
+  messages_to_send_.mutex.lock();
+  auto &queue = messages_to_send_.data;
+
+  // Karn's rule, a retransmitted message gives an ambiguous sample
+  auto acked = [this, &last_sent, &bytes_acked](const Outgoing &msg)
+  {
+    if (msg.transmissions == 1)
+    {
+      last_sent = std::max(last_sent, msg.sent_at);
     }
-    // [else] We've seen this ack before, ignore it
-    messages_to_send_.mutex.unlock();
+    newest_acked_sent_at_ = std::max(newest_acked_sent_at_, msg.sent_at);
+    bytes_acked += msg.frame_size();
+  };
+
+  // Peer has received every message below next, stop sending them,
+  // nothing past the window can have been received
+  const auto acked_below = std::min(ack.next, queue.next_unsent());
+  for (auto seq = queue.NextInFlight(queue.base(), acked_below); seq < acked_below;
+       seq = queue.NextInFlight(seq + 1, acked_below))
+  {
+    acked(queue.at(seq));
+    queue.Erase(seq);
+  }
+
+  Message::Seq highest_acked = ack.next;
+  for (Ack::Bitmap received = ack.received; received != 0; received &= received - 1)
+  {
+    auto seq = ack.base + static_cast<Message::Seq>(__builtin_ctzll(received));
+    if (queue.InFlight(seq))
+    {
+      acked(queue.at(seq));
+      queue.Erase(seq);
+    }
+    highest_acked = std::max(highest_acked, seq);
   }
+
+  if (ack.received != 0)
+  {
+    DetectLosses(highest_acked);
+  }
+
+  // The most recently sent message was acked the soonest after sending
+  if (last_sent != Clock::time_point::min())
+  {
+    rtt_.Sample(now - last_sent);
+  }
+
+  if (bytes_acked > 0)
+  {
+    bytes_in_flight_ -= bytes_acked;
+    cwnd_.OnAck(bytes_acked);
+  }
+  messages_to_send_.mutex.unlock();
 }
 
-std::size_t PerfectLink::Serialize(const Message &msg, char *buffer) noexcept
+void PerfectLink::DetectLosses(Message::Seq highest_acked) noexcept
+{
+  // Some slack so that mildly reordered datagrams are not taken for lost ones
+  const auto lost_before = newest_acked_sent_at_ - rtt_.srtt() / 4;
+  bool lost_any = false;
+
+  auto &queue = messages_to_send_.data;
+
+  // Only the holes below the highest acknowledged message are candidates
+  const auto limit = std::min(highest_acked, queue.next_unsent());
+  for (auto seq = queue.NextInFlight(queue.base(), limit); seq < limit;
+       seq = queue.NextInFlight(seq + 1, limit))
+  {
+    auto &msg = queue.at(seq);
+
+    if (msg.transmissions > 0 && msg.deadline != Clock::time_point::min() && msg.sent_at < lost_before)
+    {
+      msg.deadline = Clock::time_point::min();
+      retransmits_.Schedule(seq, msg.deadline);
+      lost_any = true;
+    }
+  }
+
+  // One decrease per window of data, however many messages it lost
+  if (lost_any && queue.base() >= recovery_point_)
+  {
+    cwnd_.OnLoss();
+    recovery_point_ = queue.next_unsent();
+  }
+}
+
+std::size_t PerfectLink::Serialize(Message::Seq seq, const Outgoing &msg, char *buffer) noexcept
 {
   PacketType pt{kMSG};
   auto pt_ptr = static_cast<char *>(static_cast<void *>(&pt));
   std::copy(pt_ptr, pt_ptr + sizeof(PacketType), buffer);
 
-  auto id_ptr = static_cast<const char *>(static_cast<const void *>(&msg.seq));
+  auto id_ptr = static_cast<const char *>(static_cast<const void *>(&seq));
   std::copy(id_ptr, id_ptr + sizeof(Message::Seq), buffer + sizeof(PacketType));
 
-  std::copy(msg.payload.begin(), msg.payload.end(), buffer + kPacketPrefixSize);
+  auto size = static_cast<PayloadSize>(msg.payload.size());
+  auto size_ptr = static_cast<const char *>(static_cast<const void *>(&size));
+  std::copy(size_ptr, size_ptr + sizeof(PayloadSize), buffer + sizeof(PacketType) + sizeof(Message::Seq));
+
+  std::copy(msg.payload.data(), msg.payload.data() + size, buffer + kMsgFrameHeaderSize);
+
+  return msg.frame_size();
+}
+
+std::size_t PerfectLink::Serialize(const Ack &ack, char *buffer) noexcept
+{
+  PacketType pt{kACK};
+  auto pt_ptr = static_cast<char *>(static_cast<void *>(&pt));
+  std::copy(pt_ptr, pt_ptr + sizeof(PacketType), buffer);
+  buffer += sizeof(PacketType);
+
+  auto next_ptr = static_cast<const char *>(static_cast<const void *>(&ack.next));
+  std::copy(next_ptr, next_ptr + sizeof(Message::Seq), buffer);
+  buffer += sizeof(Message::Seq);
+
+  auto base_ptr = static_cast<const char *>(static_cast<const void *>(&ack.base));
+  std::copy(base_ptr, base_ptr + sizeof(Message::Seq), buffer);
+  buffer += sizeof(Message::Seq);
+
+  auto received_ptr = static_cast<const char *>(static_cast<const void *>(&ack.received));
+  std::copy(received_ptr, received_ptr + sizeof(Ack::Bitmap), buffer);
 
-  return kPacketPrefixSize + msg.payload.size();
+  return kAckFrameSize;
 }
 
-std::optional<std::variant<PerfectLink::Message, PerfectLink::Ack>> PerfectLink::Parse(const std::vector<char> &bytes) noexcept
+std::optional<std::variant<PerfectLink::Message, PerfectLink::Ack>> PerfectLink::Parse(const PacketView &packet, std::size_t &offset) noexcept
 {
-  if (bytes.size() < kPacketPrefixSize)
+  if (packet.size() < offset + sizeof(PacketType))
   {
     return {};
   }
 
-  if (bytes[0] == kMSG)
+  auto frame = packet.begin() + offset;
+
+  if (frame[0] == kMSG)
   {
+    if (packet.size() < offset + kMsgFrameHeaderSize)
+    {
+      return {};
+    }
+
     Message::Seq id;
-    std::vector<char> payload;
-    payload.reserve(bytes.size());
     auto id_ptr = static_cast<char *>(static_cast<void *>(&id));
-    std::copy(bytes.begin() + sizeof(PacketType), bytes.begin() + sizeof(PacketType) + sizeof(Message::Seq), id_ptr);
-    std::copy(bytes.begin() + kPacketPrefixSize, bytes.end(), std::back_inserter(payload));
+    std::copy(frame + sizeof(PacketType), frame + sizeof(PacketType) + sizeof(Message::Seq), id_ptr);
+
+    PayloadSize size;
+    auto size_ptr = static_cast<char *>(static_cast<void *>(&size));
+    std::copy(frame + sizeof(PacketType) + sizeof(Message::Seq), frame + kMsgFrameHeaderSize, size_ptr);
+
+    if (packet.size() < offset + kMsgFrameHeaderSize + size)
+    {
+      return {};
+    }
+
+    PacketView payload = packet.Sub(offset + kMsgFrameHeaderSize, size);
+    offset += kMsgFrameHeaderSize + size;
 
 #ifdef DEBUG
     std::cout << "[DBUG] PerfectLink received a message with id " << id << " and payload size: " << payload.size() << "\n";
@@ -359,14 +907,30 @@ std::optional<std::variant<PerfectLink::Message, PerfectLink::Ack>> PerfectLink:
 
     return Message{id, payload};
   }
-  else if (bytes[0] == kACK)
+  else if (frame[0] == kACK)
   {
-    Message::Seq id;
+    if (packet.size() < offset + kAckFrameSize)
+    {
+      return {};
+    }
 
-    auto id_ptr = static_cast<char *>(static_cast<void *>(&id));
-    std::copy(bytes.begin() + sizeof(PacketType), bytes.begin() + sizeof(PacketType) + sizeof(Message::Seq), id_ptr);
+    Ack ack;
+    auto field = frame + sizeof(PacketType);
+
+    auto next_ptr = static_cast<char *>(static_cast<void *>(&ack.next));
+    std::copy(field, field + sizeof(Message::Seq), next_ptr);
+    field += sizeof(Message::Seq);
+
+    auto base_ptr = static_cast<char *>(static_cast<void *>(&ack.base));
+    std::copy(field, field + sizeof(Message::Seq), base_ptr);
+    field += sizeof(Message::Seq);
+
+    auto received_ptr = static_cast<char *>(static_cast<void *>(&ack.received));
+    std::copy(field, field + sizeof(Ack::Bitmap), received_ptr);
+
+    offset += kAckFrameSize;
 
-    return Ack{id};
+    return ack;
   }
 
   return {};
@@ -0,0 +1,158 @@
+#include "reactor.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+#ifdef DEBUG
+#include <iostream>
+#endif
+
+Reactor::Reactor()
+    : epollfd_(epoll_create1(EPOLL_CLOEXEC)),
+      timerfd_(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      eventfd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+  if (epollfd_ < 0 || timerfd_ < 0 || eventfd_ < 0)
+  {
+    throw std::runtime_error("Cannot create reactor.");
+  }
+
+  for (int fd : {timerfd_, eventfd_})
+  {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollfd_, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+      throw std::runtime_error("Cannot create reactor.");
+    }
+  }
+}
+
+Reactor::~Reactor() noexcept
+{
+  Stop();
+  close(eventfd_);
+  close(timerfd_);
+  close(epollfd_);
+}
+
+void Reactor::Watch(int fd, Handler *handler)
+{
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  if (epoll_ctl(epollfd_, EPOLL_CTL_ADD, fd, &event) < 0)
+  {
+    throw std::runtime_error("Cannot watch file descriptor.");
+  }
+
+  watched_.emplace_back(fd, handler);
+}
+
+void Reactor::AddTicker(Handler *handler) noexcept
+{
+  tickers_.push_back(handler);
+}
+
+void Reactor::Wake() noexcept
+{
+  if (idle_.exchange(false))
+  {
+    std::uint64_t one = 1;
+    [[maybe_unused]] auto res = write(eventfd_, &one, sizeof(one));
+  }
+}
+
+void Reactor::Start() noexcept
+{
+  on_.store(true);
+#ifdef DEBUG
+  std::cout << "[DBUG] Creating new thread: Reactor::Run\n";
+#endif
+  thread_ = std::thread(&Reactor::Run, this);
+}
+
+void Reactor::Stop() noexcept
+{
+  if (on_.exchange(false))
+  {
+    idle_.store(true);
+    Wake();
+    thread_.join();
+  }
+}
+
+void Reactor::Run() noexcept
+{
+  epoll_event events[kMaxEvents];
+  bool tick = true;
+
+  while (on_.load())
+  {
+    if (tick)
+    {
+      // Raised before ticking, a Wake racing with an idle tick still gets through
+      idle_.store(true);
+
+      bool busy = false;
+      for (const auto ticker : tickers_)
+      {
+        busy = ticker->OnTick() || busy;
+      }
+
+      if (busy)
+      {
+        idle_.store(false);
+      }
+
+      ArmTimer(busy);
+      tick = false;
+    }
+
+    int n = epoll_wait(epollfd_, events, kMaxEvents, -1);
+
+    for (int i = 0; i < n; ++i)
+    {
+      int fd = events[i].data.fd;
+
+      if (fd == timerfd_ || fd == eventfd_)
+      {
+        std::uint64_t count;
+        [[maybe_unused]] auto res = read(fd, &count, sizeof(count));
+        tick = true;
+        continue;
+      }
+
+      for (const auto &[watched_fd, handler] : watched_)
+      {
+        if (watched_fd == fd)
+        {
+          handler->OnReadable();
+        }
+      }
+    }
+  }
+}
+
+void Reactor::ArmTimer(bool armed) noexcept
+{
+  if (armed == timer_armed_)
+  {
+    return;
+  }
+
+  itimerspec spec{};
+  if (armed)
+  {
+    spec.it_value.tv_nsec = kTickMs * 1000000L;
+    spec.it_interval.tv_nsec = kTickMs * 1000000L;
+  }
+
+  timerfd_settime(timerfd_, 0, &spec, nullptr);
+  timer_armed_ = armed;
+}
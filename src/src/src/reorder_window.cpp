@@ -0,0 +1,26 @@
+#include "reorder_window.hpp"
+
+ReorderWindow::ReorderWindow(std::size_t capacity, std::pmr::memory_resource *resource) noexcept
+    : window_(1, capacity, capacity, resource), overflow_(resource) {}
+
+ReorderWindow::Run ReorderWindow::InsertOutOfOrder(Seq seq)
+{
+  const Seq first = window_.next();
+
+  if (seq >= first && seq - first >= window_.max_capacity())
+  {
+    overflow_.insert(seq);
+    return {first, first};
+  }
+
+  window_.Insert(seq);
+
+  // Everything in overflow was out of reach when inserted, so it is still past the watermark
+  while (window_.next() != first && !overflow_.empty() && *overflow_.begin() - window_.next() < window_.max_capacity())
+  {
+    window_.Insert(*overflow_.begin());
+    overflow_.erase(overflow_.begin());
+  }
+
+  return {first, window_.next()};
+}
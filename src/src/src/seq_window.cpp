@@ -0,0 +1,123 @@
+#include "seq_window.hpp"
+
+#include <algorithm>
+
+static std::size_t RoundCapacity(std::size_t capacity) noexcept
+{
+  std::size_t rounded = SeqWindow::kWordBits;
+  while (rounded < capacity)
+  {
+    rounded *= 2;
+  }
+  return rounded;
+}
+
+SeqWindow::SeqWindow(Seq first, std::size_t capacity, std::size_t max_capacity, std::pmr::memory_resource *resource) noexcept
+    : max_capacity_(RoundCapacity(max_capacity)), next_(first), end_(first),
+      mask_(RoundCapacity(capacity) - 1), words_(RoundCapacity(capacity) / kWordBits, 0, resource) {}
+
+bool SeqWindow::InsertAbove(Seq seq) noexcept
+{
+  if (seq < next_)
+  {
+    return false;
+  }
+
+  std::size_t offset = seq - next_;
+
+  if (offset >= words_.size() * kWordBits)
+  {
+    if (offset >= max_capacity_)
+    {
+      return false;
+    }
+
+    Grow(offset + 1);
+  }
+
+  if (Test(seq))
+  {
+    return false;
+  }
+
+  end_ = std::max(end_, seq + 1);
+
+  if (seq != next_)
+  {
+    auto index = seq & mask_;
+    words_[index / kWordBits] |= std::uint64_t{1} << (index % kWordBits);
+    size_++;
+    return true;
+  }
+
+  next_++;
+  Advance();
+
+  return true;
+}
+
+SeqWindow::Seq SeqWindow::NextAbove(Seq from) const noexcept
+{
+  from = std::max(from, next_);
+
+  // A word never wraps around the ring, so seqs and bits advance together
+  while (from < end_)
+  {
+    auto index = from & mask_;
+    auto bits = words_[index / kWordBits] >> (index % kWordBits);
+
+    if (bits != 0)
+    {
+      return std::min(end_, from + static_cast<Seq>(__builtin_ctzll(bits)));
+    }
+
+    from += static_cast<Seq>(kWordBits - index % kWordBits);
+  }
+
+  return end_;
+}
+
+void SeqWindow::Advance() noexcept
+{
+  // Moves the watermark over the run of set bits starting at it, clearing them for reuse
+  while (true)
+  {
+    auto index = next_ & mask_;
+    auto shift = index % kWordBits;
+    auto &word = words_[index / kWordBits];
+
+    auto bits = word >> shift;
+    auto run = ~bits == 0 ? kWordBits : static_cast<std::size_t>(__builtin_ctzll(~bits));
+
+    if (run == 0)
+    {
+      return;
+    }
+
+    word &= run == kWordBits ? 0 : ~(((std::uint64_t{1} << run) - 1) << shift);
+    next_ += static_cast<Seq>(run);
+    size_ -= run;
+
+    // The run ended inside this word
+    if (run < kWordBits - shift)
+    {
+      return;
+    }
+  }
+}
+
+void SeqWindow::Grow(std::size_t min_capacity) noexcept
+{
+  std::size_t capacity = RoundCapacity(min_capacity);
+  std::pmr::vector<std::uint64_t> words(capacity / kWordBits, 0, words_.get_allocator());
+  const std::size_t mask = capacity - 1;
+
+  for (Seq seq = NextAbove(next_); seq < end_; seq = NextAbove(seq + 1))
+  {
+    auto index = seq & mask;
+    words[index / kWordBits] |= std::uint64_t{1} << (index % kWordBits);
+  }
+
+  mask_ = mask;
+  words_.swap(words);
+}
@@ -0,0 +1,31 @@
+#include "shared_payload.hpp"
+
+#include <new>
+#include <cstring>
+
+SharedPayload::SharedPayload(const char *bytes, std::size_t len) : size_(static_cast<std::uint32_t>(len))
+{
+  if (!spilled())
+  {
+    // An empty payload may come with a null bytes, which memcpy must not be given
+    if (len > 0)
+    {
+      std::memcpy(storage_.bytes, bytes, len);
+    }
+    return;
+  }
+
+  // A single allocation, the header with the bytes right behind it
+  void *mem = ::operator new(sizeof(Block) + len);
+  storage_.block = new (mem) Block{{1}};
+  std::memcpy(static_cast<char *>(mem) + sizeof(Block), bytes, len);
+}
+
+SharedPayload::~SharedPayload() noexcept
+{
+  if (spilled() && storage_.block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    storage_.block->~Block();
+    ::operator delete(storage_.block);
+  }
+}
@@ -0,0 +1,97 @@
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+
+void TimerWheel::Schedule(Key key, Clock::time_point deadline) noexcept
+{
+  size_++;
+
+  if (deadline <= start_)
+  {
+    due_.push_back(key);
+    return;
+  }
+
+  // Rounded up, so that a timer never fires before its deadline
+  auto elapsed = deadline - start_;
+  auto tick = static_cast<Tick>((elapsed + resolution_ - Clock::duration{1}) / resolution_);
+
+  if (tick <= now_)
+  {
+    due_.push_back(key);
+    return;
+  }
+
+  Place({key, std::min(tick, now_ | (kHorizon - 1))});
+}
+
+void TimerWheel::Advance(Clock::time_point now, std::vector<Key> &expired) noexcept
+{
+  Tick target = now < start_ ? 0 : static_cast<Tick>((now - start_) / resolution_);
+
+  if (!due_.empty())
+  {
+    expired.insert(expired.end(), due_.begin(), due_.end());
+    size_ -= due_.size();
+    due_.clear();
+  }
+
+  while (now_ < target && size_ > 0)
+  {
+    now_++;
+
+    // Crossing into a new slot of an upper level brings its timers down,
+    // highest level first as they may land in a lower slot being crossed too
+    unsigned int levels = 1;
+    while (levels < kLevels && (now_ & ((Tick{1} << (kSlotBits * levels)) - 1)) == 0)
+    {
+      levels++;
+    }
+
+    for (unsigned int level = levels - 1; level > 0; --level)
+    {
+      Cascade(level);
+    }
+
+    auto &slot = slots_[0][now_ & (kSlots - 1)];
+    for (const auto &timer : slot)
+    {
+      expired.push_back(timer.key);
+    }
+    size_ -= slot.size();
+    slot.clear();
+  }
+
+  // Nothing left to fire, skip over the idle ticks
+  if (now_ < target)
+  {
+    now_ = target;
+  }
+}
+
+void TimerWheel::Place(const Timer &timer) noexcept
+{
+  // The level is the highest digit where the tick differs from now
+  Tick diff = timer.tick ^ now_;
+  unsigned int level = 0;
+  while (diff >= kSlots)
+  {
+    diff >>= kSlotBits;
+    level++;
+  }
+
+  slots_[level][(timer.tick >> (kSlotBits * level)) & (kSlots - 1)].push_back(timer);
+}
+
+void TimerWheel::Cascade(unsigned int level) noexcept
+{
+  auto &slot = slots_[level][(now_ >> (kSlotBits * level)) & (kSlots - 1)];
+
+  std::vector<Timer> timers;
+  timers.swap(slot);
+
+  for (const auto &timer : timers)
+  {
+    Place(timer);
+  }
+}
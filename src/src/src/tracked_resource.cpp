@@ -0,0 +1,59 @@
+#include "tracked_resource.hpp"
+
+#include <algorithm>
+
+void *TrackedResource::Heap::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    n_allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void TrackedResource::Heap::do_deallocate(void *ptr, std::size_t bytes, std::size_t alignment)
+{
+    std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+}
+
+bool TrackedResource::Heap::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
+
+TrackedResource::TrackedResource(bool pooled) : upstream_(&heap_)
+{
+    if (pooled)
+    {
+        pool_.emplace(&heap_);
+        upstream_ = &pool_.value();
+    }
+}
+
+TrackedResource::Stats TrackedResource::stats() const noexcept
+{
+    return {n_allocations_.load(std::memory_order_relaxed),
+            heap_.n_allocations.load(std::memory_order_relaxed),
+            peak_bytes_.load(std::memory_order_relaxed)};
+}
+
+void *TrackedResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    void *ptr = upstream_->allocate(bytes, alignment);
+
+    // Only ever written under the structure's lock, atomic so stats can be read from anywhere
+    n_allocations_.fetch_add(1, std::memory_order_relaxed);
+    auto in_use = bytes_.load(std::memory_order_relaxed) + bytes;
+    bytes_.store(in_use, std::memory_order_relaxed);
+    peak_bytes_.store(std::max(peak_bytes_.load(std::memory_order_relaxed), in_use), std::memory_order_relaxed);
+
+    return ptr;
+}
+
+void TrackedResource::do_deallocate(void *ptr, std::size_t bytes, std::size_t alignment)
+{
+    upstream_->deallocate(ptr, bytes, alignment);
+    bytes_.store(bytes_.load(std::memory_order_relaxed) - bytes, std::memory_order_relaxed);
+}
+
+bool TrackedResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
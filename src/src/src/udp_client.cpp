@@ -1,12 +1,15 @@
 #include "udp_client.hpp"
 
 #include <cstring>
+#include <algorithm>
 #include <unistd.h>
 #include <stdexcept>
 #include <sys/types.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 
+#include "uring_transport.hpp"
+
 UDPClient::UDPClient()
     : sockfd_(socket(AF_INET, SOCK_DGRAM, 0)), sock_owner_(true)
 {
@@ -16,8 +19,11 @@ UDPClient::UDPClient()
     }
 }
 
-UDPClient::UDPClient(int sockfd, bool sock_owner)
-    : sockfd_(sockfd), sock_owner_(sock_owner)
+UDPClient::UDPClient(int sockfd, bool sock_owner, std::size_t send_batch, std::size_t mtu)
+    : sockfd_(sockfd),
+      sock_owner_(sock_owner),
+      send_batch_(std::clamp(send_batch, static_cast<std::size_t>(1), kMaxSendBatch)),
+      mtu_(std::clamp(mtu, static_cast<std::size_t>(1), UDPServer::kMaxSendSize))
 {
     if (sockfd_ < 0)
     {
@@ -36,15 +42,186 @@ UDPClient::~UDPClient() noexcept
 ssize_t UDPClient::Send(const char *bytes, std::size_t len, sockaddr_in to_addr) const
 {
     ssize_t res = sendto(sockfd_, bytes, len, 0, reinterpret_cast<struct sockaddr *>(&to_addr), sizeof(to_addr));
+    n_send_calls_.fetch_add(1, std::memory_order_relaxed);
 
     if (res < 0)
     {
         throw std::runtime_error("Error sending message.");
     }
 
+    n_packets_sent_.fetch_add(1, std::memory_order_relaxed);
+    n_bytes_sent_.fetch_add(static_cast<std::uint64_t>(res), std::memory_order_relaxed);
+
     return res;
 }
 
+void UDPClient::Queue(Batch &batch, const char *bytes, std::size_t len, sockaddr_in to_addr) const
+{
+    if (send_batch_ == 1)
+    {
+        [[maybe_unused]] ssize_t res = Send(bytes, len, to_addr);
+        return;
+    }
+
+    // Pushed before flushing, so a failed flush counts this datagram with the rest of the batch
+    batch.client_ = this;
+    batch.Push(bytes, len, to_addr);
+
+    if (batch.size() >= send_batch_)
+    {
+        Flush(batch);
+    }
+}
+
+std::size_t UDPClient::Flush(Batch &batch) const
+{
+    if (batch.size_ == 0)
+    {
+        return 0;
+    }
+
+    if (transport_ != nullptr)
+    {
+        return FlushTransport(batch);
+    }
+
+    // The datagrams were appended to contiguous storage, only now
+    // that it cannot grow anymore is it safe to point into it
+    batch.iovecs_.resize(batch.size_);
+    batch.msgs_.resize(batch.size_);
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < batch.size_; ++i)
+    {
+        batch.iovecs_[i].iov_base = batch.bytes_.data() + offset;
+        batch.iovecs_[i].iov_len = batch.lens_[i];
+        batch.msgs_[i].msg_hdr = {};
+        batch.msgs_[i].msg_hdr.msg_iov = &batch.iovecs_[i];
+        batch.msgs_[i].msg_hdr.msg_iovlen = 1;
+        batch.msgs_[i].msg_hdr.msg_name = &batch.addrs_[i];
+        batch.msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        offset += batch.lens_[i];
+    }
+
+    std::size_t sent = 0;
+    std::size_t failed = 0;
+    std::size_t bytes = batch.bytes_.size();
+    while (sent + failed < batch.size_)
+    {
+        std::size_t next = sent + failed;
+        int res = sendmmsg(sockfd_, batch.msgs_.data() + next, static_cast<unsigned int>(batch.size_ - next), 0);
+        n_send_calls_.fetch_add(1, std::memory_order_relaxed);
+
+        if (res <= 0)
+        {
+            // The datagram at the head of the batch could not be sent,
+            // drop it as the network would and carry on with the rest
+            bytes -= batch.lens_[next];
+            ++failed;
+        }
+        else
+        {
+            sent += static_cast<std::size_t>(res);
+        }
+    }
+
+    n_packets_sent_.fetch_add(sent, std::memory_order_relaxed);
+    n_bytes_sent_.fetch_add(bytes, std::memory_order_relaxed);
+
+    batch.size_ = 0;
+    batch.bytes_.clear();
+    batch.lens_.clear();
+    batch.addrs_.clear();
+
+    if (failed > 0)
+    {
+        throw std::runtime_error("Error sending message.");
+    }
+
+    return sent;
+}
+
+std::size_t UDPClient::FlushTransport(Batch &batch) const
+{
+    std::size_t sent = 0;
+    std::size_t bytes = 0;
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < batch.size_; ++i)
+    {
+        if (transport_->Queue(batch.bytes_.data() + offset, batch.lens_[i], batch.addrs_[i]))
+        {
+            ++sent;
+            bytes += batch.lens_[i];
+        }
+        offset += batch.lens_[i];
+    }
+
+    transport_->Submit();
+    n_send_calls_.fetch_add(1, std::memory_order_relaxed);
+    n_packets_sent_.fetch_add(sent, std::memory_order_relaxed);
+    n_bytes_sent_.fetch_add(bytes, std::memory_order_relaxed);
+
+    std::size_t failed = batch.size_ - sent;
+    batch.size_ = 0;
+    batch.bytes_.clear();
+    batch.lens_.clear();
+    batch.addrs_.clear();
+
+    if (failed > 0)
+    {
+        throw std::runtime_error("Error sending message.");
+    }
+
+    return sent;
+}
+
+std::size_t UDPClient::Batch::Flush()
+{
+    if (client_ == nullptr)
+    {
+        return 0;
+    }
+
+    return client_->Flush(*this);
+}
+
+void UDPClient::Batch::Push(const char *bytes, std::size_t len, sockaddr_in to_addr)
+{
+    bytes_.insert(bytes_.end(), bytes, bytes + len);
+    lens_.push_back(len);
+    addrs_.push_back(to_addr);
+    ++size_;
+}
+
+void UDPClient::Use(UringTransport &transport) noexcept
+{
+    transport_ = &transport;
+}
+
+std::size_t UDPClient::send_batch() const noexcept
+{
+    return send_batch_;
+}
+
+std::size_t UDPClient::mtu() const noexcept
+{
+    return mtu_;
+}
+
+std::uint64_t UDPClient::n_packets_sent() const noexcept
+{
+    return n_packets_sent_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t UDPClient::n_send_calls() const noexcept
+{
+    return n_send_calls_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t UDPClient::n_bytes_sent() const noexcept
+{
+    return n_bytes_sent_.load(std::memory_order_relaxed);
+}
+
 sockaddr_in UDPClient::Address(in_addr_t ip, in_port_t port) noexcept
 {
     sockaddr_in address{};
@@ -2,33 +2,117 @@
 
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <linux/filter.h>
 
 #include "udp_client.hpp"
 
-UDPServer::UDPServer(in_addr_t ip, in_port_t port)
-    : sockfd_(socket(AF_INET, SOCK_DGRAM, 0)),
-      server_addr_(UDPClient::Address(ip, port))
+UDPServer::UDPServer(in_addr_t ip, in_port_t port, std::size_t recv_batch, std::size_t recv_shards)
+    : server_addr_(UDPClient::Address(ip, port)),
+      recv_batch_(std::clamp(recv_batch, static_cast<std::size_t>(1), kMaxRecvBatch))
 {
-    if (sockfd_ < 0)
+    recv_shards = std::clamp(recv_shards, static_cast<std::size_t>(1), kMaxRecvShards);
+
+    // Sockets join the group in bind order, which is the index the steering program returns
+    shards_.reserve(recv_shards);
+    for (std::size_t i = 0; i < recv_shards; ++i)
+    {
+        shards_.push_back(std::make_unique<Shard>(*this, OpenSocket(recv_shards > 1)));
+    }
+
+    if (recv_shards > 1)
+    {
+        AttachSteering();
+    }
+}
+
+UDPServer::Shard::Shard(UDPServer &server, int sockfd) : server(server), sockfd(sockfd)
+{
+    recv_packets.reserve(server.recv_batch_);
+    for (std::size_t i = 0; i < server.recv_batch_; ++i)
+    {
+        recv_packets.push_back(server.pool_.Acquire());
+    }
+
+    if (server.recv_batch_ > 1)
+    {
+        recv_msgs.resize(server.recv_batch_);
+        recv_iovecs.resize(server.recv_batch_);
+        recv_addrs.resize(server.recv_batch_);
+    }
+}
+
+int UDPServer::OpenSocket(bool reuseport) const
+{
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0)
     {
         throw std::runtime_error("Cannot create socket.");
     }
 
-    if (bind(sockfd_, reinterpret_cast<const sockaddr *>(&server_addr_), sizeof(server_addr_)) < 0)
+    if (reuseport)
+    {
+        int one = 1;
+        if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)
+        {
+            throw std::runtime_error("Cannot set SO_REUSEPORT on socket.");
+        }
+    }
+
+    if (bind(sockfd, reinterpret_cast<const sockaddr *>(&server_addr_), sizeof(server_addr_)) < 0)
     {
         throw std::runtime_error("Could not bind to socket.");
     }
+
+    return sockfd;
+}
+
+void UDPServer::AttachSteering() const
+{
+    // shard = (source ip ^ source port) % shards, read off the IPv4 header
+    // (assumed to carry no options) as loads are relative to the payload
+    sock_filter code[] = {
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<std::uint32_t>(SKF_NET_OFF + 12)},
+        {BPF_MISC | BPF_TAX, 0, 0, 0},
+        {BPF_LD | BPF_H | BPF_ABS, 0, 0, static_cast<std::uint32_t>(SKF_NET_OFF + 20)},
+        {BPF_ALU | BPF_XOR | BPF_X, 0, 0, 0},
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<std::uint32_t>(shards_.size())},
+        {BPF_RET | BPF_A, 0, 0, 0},
+    };
+    sock_fprog program = {sizeof(code) / sizeof(code[0]), code};
+
+    // Without it the kernel's own flow hash still keeps a peer on one shard,
+    // only the observers have to be looked up on another shard than the one receiving
+    if (setsockopt(shards_.front()->sockfd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0)
+    {
+        std::cerr << "Cannot attach steering program, relying on the kernel's hash.\n";
+    }
 }
 
 void UDPServer::Start() noexcept
 {
+    BuildDispatch();
     on_.store(true);
+    for (const auto &shard : shards_)
+    {
 #ifdef DEBUG
-    std::cout << "[DBUG] Creating new thread: UDPServer::Receive\n";
+        std::cout << "[DBUG] Creating new thread: UDPServer::Shard::Receive\n";
 #endif
-    receive_thread_ = std::thread(&UDPServer::Receive, this);
+        shard->receive_thread = std::thread(&Shard::Receive, shard.get());
+    }
+}
+
+void UDPServer::Start(Reactor &reactor)
+{
+    BuildDispatch();
+    on_.store(true);
+    for (const auto &shard : shards_)
+    {
+        reactor.Watch(shard->sockfd, shard.get());
+    }
 }
 
 void UDPServer::Stop() noexcept
@@ -36,48 +120,293 @@ void UDPServer::Stop() noexcept
     if (on_.load())
     {
         on_.store(false);
-        shutdown(sockfd_, SHUT_RDWR);
-        receive_thread_.join();
+        for (const auto &shard : shards_)
+        {
+            shutdown(shard->sockfd, SHUT_RDWR);
+        }
+        for (const auto &shard : shards_)
+        {
+            if (shard->receive_thread.joinable())
+            {
+                shard->receive_thread.join();
+            }
+        }
     }
 }
 
-void UDPServer::Receive() noexcept
+void UDPServer::Shard::Receive() noexcept
 {
-    while (on_.load())
+    // Block until at least one datagram is available, then drain
+    // whatever else is already queued without blocking again
+    int flags = server.recv_batch_ > 1 ? MSG_WAITFORONE : 0;
+
+    while (server.on_.load())
     {
-        char buffer[kMaxSendSize];
-        sockaddr_in addr{};
-        socklen_t addr_len = sizeof(addr);
-        ssize_t len = recvfrom(sockfd_, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr *>(&addr), &addr_len);
-        if (len > 0)
+        ReceiveOnce(flags);
+    }
+}
+
+void UDPServer::Shard::OnReadable() noexcept
+{
+    for (std::size_t i = 0; i < kMaxDrainCalls && server.on_.load(); ++i)
+    {
+        // A short batch means the socket has been drained
+        if (ReceiveOnce(MSG_DONTWAIT) < server.recv_batch_)
         {
-            std::vector<char> payload;
-            payload.reserve(addr_len);
-            std::copy(buffer, buffer + len, std::back_inserter(payload));
-            NotifyAll(payload, addr);
+            return;
         }
     }
 }
 
+std::size_t UDPServer::Shard::ReceiveOnce(int flags) noexcept
+{
+    if (server.recv_batch_ > 1)
+    {
+        return ReceiveBatchOnce(flags);
+    }
+
+    PacketPool::Ref &packet = recv_packets.front();
+    sockaddr_in addr{};
+    socklen_t addr_len = sizeof(addr);
+    ssize_t len = recvfrom(sockfd, packet.data(), kMaxSendSize, flags, reinterpret_cast<sockaddr *>(&addr), &addr_len);
+    n_receive_calls.fetch_add(1, std::memory_order_relaxed);
+    if (len > 0)
+    {
+        n_packets_received.fetch_add(1, std::memory_order_relaxed);
+        packet.resize(static_cast<std::size_t>(len));
+        server.NotifyAll(PacketView(packet), addr);
+        return 1;
+    }
+
+    return 0;
+}
+
+std::size_t UDPServer::Shard::ReceiveBatchOnce(int flags) noexcept
+{
+    for (std::size_t i = 0; i < recv_msgs.size(); ++i)
+    {
+        recv_iovecs[i].iov_base = recv_packets[i].data();
+        recv_iovecs[i].iov_len = kMaxSendSize;
+        recv_msgs[i].msg_hdr = {};
+        recv_msgs[i].msg_hdr.msg_iov = &recv_iovecs[i];
+        recv_msgs[i].msg_hdr.msg_iovlen = 1;
+        recv_msgs[i].msg_hdr.msg_name = &recv_addrs[i];
+        recv_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+
+    int n = recvmmsg(sockfd, recv_msgs.data(), static_cast<unsigned int>(recv_msgs.size()), flags, nullptr);
+    n_receive_calls.fetch_add(1, std::memory_order_relaxed);
+    if (n > 0)
+    {
+        n_packets_received.fetch_add(static_cast<std::uint64_t>(n), std::memory_order_relaxed);
+        NotifyAll(static_cast<std::size_t>(n));
+        return static_cast<std::size_t>(n);
+    }
+
+    return 0;
+}
+
 void UDPServer::Attach(Observer *obs, sockaddr_in addr) noexcept
 {
-    observers_.mutex.lock();
-    observers_.data[Machine{addr.sin_addr.s_addr, addr.sin_port}].push_back(obs);
-    observers_.mutex.unlock();
+    const Machine machine{addr.sin_addr.s_addr, addr.sin_port};
+    auto &observers = ShardOf(machine).observers;
+
+    observers.mutex.lock();
+    observers.data[machine].push_back(obs);
+    observers.mutex.unlock();
+}
+
+UDPServer::Shard &UDPServer::ShardOf(const Machine &machine) const noexcept
+{
+    std::uint32_t hash = ntohl(machine.ip) ^ ntohs(machine.port);
+    return *shards_[hash % shards_.size()];
 }
 
-void UDPServer::NotifyAll(const std::vector<char> &bytes, sockaddr_in addr)
+void UDPServer::NotifyAll(const PacketView &packet, sockaddr_in addr)
 {
-    observers_.mutex.lock_shared();
-    std::vector<Observer *> observers(observers_.data[Machine{addr.sin_addr.s_addr, addr.sin_port}]);
-    observers_.mutex.unlock_shared();
-    for (const auto &obs : observers)
+    const Machine machine{addr.sin_addr.s_addr, addr.sin_port};
+    auto [begin, end] = ShardOf(machine).dispatch.Find(machine);
+    for (auto obs = begin; obs != end; ++obs)
     {
-        obs->Notify(bytes);
+        (*obs)->Notify(packet);
+    }
+}
+
+void UDPServer::Shard::NotifyAll(std::size_t n_packets)
+{
+    for (std::size_t i = 0; i < n_packets; ++i)
+    {
+        if (recv_msgs[i].msg_len == 0)
+        {
+            continue;
+        }
+
+        // Steering keeps the owner this shard, unless the kernel's hash is in use instead
+        const Machine machine{recv_addrs[i].sin_addr.s_addr, recv_addrs[i].sin_port};
+        auto [begin, end] = server.ShardOf(machine).dispatch.Find(machine);
+        if (begin == end)
+        {
+            continue;
+        }
+
+        recv_packets[i].resize(recv_msgs[i].msg_len);
+        const PacketView packet(recv_packets[i]);
+        for (auto obs = begin; obs != end; ++obs)
+        {
+            (*obs)->Notify(packet);
+        }
+    }
+}
+
+void UDPServer::ObserverTable::Build(const std::unordered_map<Machine, std::vector<Observer *>> &observers)
+{
+    std::size_t n_buckets = 1;
+    while (n_buckets * 4 < observers.size())
+    {
+        n_buckets *= 2;
+    }
+
+    std::vector<std::vector<Machine>> buckets(n_buckets);
+    for (const auto &[machine, _] : observers)
+    {
+        buckets[Hash(machine, kBucketSeed) & (n_buckets - 1)].push_back(machine);
+    }
+
+    // Largest buckets first, while most slots are still free
+    std::vector<std::size_t> order(n_buckets);
+    for (std::size_t i = 0; i < n_buckets; ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t b1, std::size_t b2)
+              { return buckets[b1].size() > buckets[b2].size(); });
+
+    std::size_t capacity = 1;
+    while (capacity < 2 * observers.size())
+    {
+        capacity *= 2;
+    }
+
+    std::vector<std::uint64_t> seeds(n_buckets);
+    std::vector<Slot> slots;
+
+    // At half load a seed is found within a few tries, the table only grows if one is not
+    for (bool placed = false; !placed; capacity *= 2)
+    {
+        slots.assign(capacity, Slot{});
+        placed = true;
+
+        for (const auto bucket : order)
+        {
+            bool bucket_placed = false;
+
+            for (std::uint64_t seed = 1; seed <= kMaxSeedTries && !bucket_placed; ++seed)
+            {
+                bucket_placed = true;
+                for (std::size_t i = 0; i < buckets[bucket].size() && bucket_placed; ++i)
+                {
+                    Slot &slot = slots[Hash(buckets[bucket][i], seed) & (capacity - 1)];
+                    if (slot.begin != slot.end)
+                    {
+                        bucket_placed = false;
+                    }
+                    else
+                    {
+                        // Marked taken, so that the bucket does not collide with itself
+                        slot.machine = buckets[bucket][i];
+                        slot.end = 1;
+                    }
+                }
+
+                if (bucket_placed)
+                {
+                    seeds[bucket] = seed;
+                    break;
+                }
+
+                for (const auto &machine : buckets[bucket])
+                {
+                    Slot &slot = slots[Hash(machine, seed) & (capacity - 1)];
+                    if (slot.machine == machine)
+                    {
+                        slot = Slot{};
+                    }
+                }
+            }
+
+            if (!bucket_placed)
+            {
+                placed = false;
+                break;
+            }
+        }
+
+        if (placed)
+        {
+            mask_ = capacity - 1;
+        }
+    }
+
+    observers_.clear();
+    for (auto &slot : slots)
+    {
+        if (slot.begin == slot.end)
+        {
+            continue;
+        }
+
+        const auto &machine_observers = observers.at(slot.machine);
+        slot.begin = static_cast<std::uint32_t>(observers_.size());
+        observers_.insert(observers_.end(), machine_observers.begin(), machine_observers.end());
+        slot.end = static_cast<std::uint32_t>(observers_.size());
+    }
+
+    bucket_mask_ = n_buckets - 1;
+    seeds_.swap(seeds);
+    slots_.swap(slots);
+}
+
+void UDPServer::BuildDispatch()
+{
+    for (const auto &shard : shards_)
+    {
+        shard->observers.mutex.lock_shared();
+        shard->dispatch.Build(shard->observers.data);
+        shard->observers.mutex.unlock_shared();
     }
 }
 
 int UDPServer::sockfd() const noexcept
 {
-    return sockfd_;
+    return shards_.front()->sockfd;
+}
+
+std::size_t UDPServer::recv_batch() const noexcept
+{
+    return recv_batch_;
+}
+
+std::size_t UDPServer::recv_shards() const noexcept
+{
+    return shards_.size();
+}
+
+std::uint64_t UDPServer::n_packets_received() const noexcept
+{
+    std::uint64_t n = 0;
+    for (const auto &shard : shards_)
+    {
+        n += shard->n_packets_received.load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+std::uint64_t UDPServer::n_receive_calls() const noexcept
+{
+    std::uint64_t n = 0;
+    for (const auto &shard : shards_)
+    {
+        n += shard->n_receive_calls.load(std::memory_order_relaxed);
+    }
+    return n;
 }
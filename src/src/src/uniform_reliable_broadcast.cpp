@@ -1,46 +1,16 @@
 #include "uniform_reliable_broadcast.hpp"
 
 #include <cmath>
-
-void UniformReliableBroadcast::DeliveredSet::PeerState::Insert(Broadcast::Message::Id::Seq seq) noexcept
-{
-    if (seq == bottom_)
-    {
-        bottom_++;
-
-        std::vector<Broadcast::Message::Id::Seq> to_remove;
-        to_remove.reserve(delivered_.size());
-
-        for (const auto seq : delivered_)
-        {
-            if (seq == bottom_)
-            {
-                to_remove.emplace_back(seq);
-                bottom_++;
-            }
-            else
-            {
-                break;
-            }
-        }
-
-        for (const auto seq : to_remove)
-        {
-            delivered_.erase(seq);
-        }
-    }
-    else
-    {
-        delivered_.insert(seq);
-    }
-}
+#include <limits>
+#include <cstring>
+#include <algorithm>
 
 std::size_t UniformReliableBroadcast::DeliveredSet::Size() const noexcept
 {
     std::size_t res = 0;
-    for (const auto &[_, peer_state] : state_)
+    for (const auto &window : state_)
     {
-        res += peer_state.Size();
+        res += window.size();
     }
     return res;
 }
@@ -50,123 +20,467 @@ void UniformReliableBroadcast::Add(std::unique_ptr<PerfectLink> pl) noexcept
     const PerfectLink::Id id = pl->target_id();
 
     perfect_links_.mutex.lock();
+    perfect_links_.data.Resize(id);
     perfect_links_.data[id] = std::move(pl);
     perfect_links_.data[id]->Subscribe(this);
     perfect_links_.mutex.unlock();
 
+    acks_.mutex.lock();
+    acks_.data.Reserve(id);
+    acks_.mutex.unlock();
+
+    // Own messages get delivered too, the own id may be past every peer's
+    delivered_.mutex.lock();
+    delivered_.data.Reserve(std::max(id, id_));
+    delivered_.mutex.unlock();
+
     n_processes_.fetch_add(1);
-    n_own_pending_delivery_ideal_.store(static_cast<unsigned int>(std::max(1, static_cast<int>(URB_MAX_MSGS_IN_NETWORK / std::pow(n_processes_.load(), 2)))));
+
+    // Only a starting point, the window adapts to the delivery latency from there
+    own_sent_at_.mutex.lock();
+    own_window_.Resize(std::max(1.0, URB_MAX_MSGS_IN_NETWORK / std::pow(n_processes_.load(), 2)));
+    n_own_pending_delivery_ideal_.store(own_window_.window());
+    own_sent_at_.mutex.unlock();
 }
 
 void UniformReliableBroadcast::Send(const std::string &msg) noexcept
 {
     Broadcast::Message::Id::Seq seq = n_messages_sent_.fetch_add(1);
-    Broadcast::Message message = {{seq, id_}, id_, {msg.begin(), msg.end()}};
 
     LogSend(seq);
 
-    if (n_own_pending_for_delivery_.load() >= n_own_pending_delivery_ideal_.load())
+    // Deliveries drain the queue under the same lock, so a message queued here is always seen by one
+    own_pending_for_broadcast_.mutex.lock();
+    if (!own_pending_for_broadcast_.data.empty() || n_own_pending_for_delivery_.load() >= n_own_pending_delivery_ideal_.load())
     {
-        own_pending_for_broadcast_.mutex.lock_shared();
-        own_pending_for_broadcast_.data.push(message);
-        own_pending_for_broadcast_.mutex.unlock_shared();
+        own_pending_for_broadcast_.data.push({seq, SharedPayload(msg.data(), msg.size())});
+        own_pending_for_broadcast_.mutex.unlock();
         return;
     }
-
     n_own_pending_for_delivery_.fetch_add(1);
-    SendInternal(message);
+    own_pending_for_broadcast_.mutex.unlock();
+
+    SendInternal({{seq, id_}, id_, PacketView(msg)});
 }
 
 void UniformReliableBroadcast::NotifyInternal(const Broadcast::Message &msg) noexcept
 {
-    BestEffortBroadcast::NotifyInternal(msg);
+    if (msg.id.author == kDigestAuthor)
+    {
+        NotifyDigest(msg);
+        return;
+    }
 
-    pending_for_delivery_.mutex.lock_shared();
-    bool not_pending = pending_for_delivery_.data.count(msg.id) == 0;
-    pending_for_delivery_.mutex.unlock_shared();
+    BestEffortBroadcast::NotifyInternal(msg);
 
+    // Deliver moves the message from pending to delivered under the pending lock, so checking
+    // both under it and acking there neither re-adds a delivered message nor leaves an ack row behind
+    pending_for_delivery_.mutex.lock();
     delivered_.mutex.lock_shared();
-    bool not_delivered = !delivered_.data.Contains(msg.id);
+    bool known = delivered_.data.Knows(msg.id.author);
+    bool delivered = delivered_.data.Contains(msg.id);
     delivered_.mutex.unlock_shared();
 
-    if (not_delivered)
+    // Corrupt or foreign, no process has that id
+    if (!known || delivered)
     {
-        acks_.mutex.lock();
-        acks_.data[msg.id].insert(msg.sender);
-        acks_.mutex.unlock();
+        pending_for_delivery_.mutex.unlock();
+        return;
+    }
+
+    // Only the first copy received is relayed (or acked by digest), whichever thread got it
+    bool first_copy = pending_for_delivery_.data.insert(msg.id).second;
 
-        if (not_pending)
+    acks_.mutex.lock();
+    auto n_acks = acks_.data.Ack(msg.id, msg.sender);
+    acks_.mutex.unlock();
+    pending_for_delivery_.mutex.unlock();
+
+    if (first_copy)
+    {
+        if (digest_acks_)
+        {
+            QueueDigestAck(msg);
+        }
+        else
         {
-            pending_for_delivery_.mutex.lock();
-            pending_for_delivery_.data.insert(msg.id);
-            pending_for_delivery_.mutex.unlock();
 #ifdef DEBUG
             std::cout << "[DBUG] URB Relaying: " << msg.id.author << " " << msg.id.seq << "\n";
 #endif
             BestEffortBroadcast::SendInternal(msg);
         }
     }
+
+    if (MajorityAcked(n_acks))
+    {
+        Deliver(msg.id);
+    }
 }
 
 void UniformReliableBroadcast::DeliverPending() noexcept
+{
+    while (on_.load())
+    {
+        DeliverDue();
+        std::this_thread::sleep_for(std::chrono::milliseconds(kDeliverTickMs));
+    }
+}
+
+bool UniformReliableBroadcast::DeliverDue() noexcept
+{
+    if (digest_acks_)
+    {
+        SendDigests();
+        RelayUnacked();
+    }
+
+    std::vector<TimerWheel::Key> due;
+
+    delivery_checks_.mutex.lock();
+    delivery_checks_.data.Advance(TimerWheel::Clock::now(), due);
+#ifdef DEBUG
+    std::cout << "[DBUG] URB Pending Checks: " << delivery_checks_.data.size() << "\n";
+#endif
+    delivery_checks_.mutex.unlock();
+
+    for (const auto key : due)
     {
-        while (on_.load())
+        const auto id = FromKey(key);
+
+        delivered_.mutex.lock_shared();
+        bool delivered = delivered_.data.Contains(id);
+        delivered_.mutex.unlock_shared();
+
+        if (delivered)
+        {
+            continue;
+        }
+
+        acks_.mutex.lock_shared();
+        auto n_acks = acks_.data.Count(id);
+        acks_.mutex.unlock_shared();
+
+        if (MajorityAcked(n_acks))
         {
-            pending_for_delivery_.mutex.lock();
-            std::vector<Broadcast::Message::Id> pending_messages(pending_for_delivery_.data.begin(), pending_for_delivery_.data.end());
+            Deliver(id);
+        }
+    }
+
+    delivery_checks_.mutex.lock_shared();
+    bool checks_pending = delivery_checks_.data.size() > 0;
+    delivery_checks_.mutex.unlock_shared();
+
+    relay_checks_.mutex.lock_shared();
+    checks_pending = checks_pending || relay_checks_.data.size() > 0;
+    relay_checks_.mutex.unlock_shared();
+
+    return checks_pending;
+}
+
+void UniformReliableBroadcast::Deliver(const Broadcast::Message::Id &id) noexcept
+{
+    // Several threads can see the majority, the one that moves the message from pending to delivered
+    // delivers it. Both change under the pending lock, so no thread sees it in neither (locks nest in
+    // the order pending, delivered, acks)
+    pending_for_delivery_.mutex.lock();
+    delivered_.mutex.lock();
+    bool deliver = pending_for_delivery_.data.count(id) > 0 && !delivered_.data.Contains(id);
+    if (deliver)
+    {
+        delivered_.data.Insert(id);
+        pending_for_delivery_.data.erase(id);
+    }
+    delivered_.mutex.unlock();
+    pending_for_delivery_.mutex.unlock();
+
+    if (!deliver)
+    {
+        return;
+    }
+
+    if (id.author == id_)
+    {
+        n_own_pending_for_delivery_.fetch_sub(1);
+        RecordOwnDelivery(id.seq);
+        DrainOwnPending();
+    }
+
+    // A message still to be relayed keeps its acks, RelayUnacked drops them once done
+    bool relay_pending = false;
+    if (digest_acks_)
+    {
+        relay_payloads_.mutex.lock_shared();
+        relay_pending = relay_payloads_.data.count(id) > 0;
+        relay_payloads_.mutex.unlock_shared();
+    }
+
+    if (!relay_pending)
+    {
+        acks_.mutex.lock();
+        acks_.data.Erase(id);
+        acks_.mutex.unlock();
+    }
 #ifdef DEBUG
-            std::cout << "[DBUG] URB Pending: " << pending_for_delivery_.data.size() << "\n";
+    std::cout << "[DBUG] URB Delivering: " << id.author << " " << id.seq << "\n";
 #endif
-            pending_for_delivery_.mutex.unlock();
+    deliver_mutex_.lock();
+    DeliverInternal(id, true);
+    deliver_mutex_.unlock();
+}
 
-            for (const auto &id : pending_messages)
-            {
-                acks_.mutex.lock();
-                bool majority_seen = (acks_.data[id].size() + 1) > static_cast<std::size_t>(std::floor(n_processes_.load() / 2));
-                acks_.mutex.unlock();
+void UniformReliableBroadcast::DrainOwnPending() noexcept
+{
+    while (true)
+    {
+        own_pending_for_broadcast_.mutex.lock();
+        if (own_pending_for_broadcast_.data.empty() || n_own_pending_for_delivery_.load() >= n_own_pending_delivery_ideal_.load())
+        {
+            own_pending_for_broadcast_.mutex.unlock();
+            return;
+        }
+        auto queued = std::move(own_pending_for_broadcast_.data.front());
+        own_pending_for_broadcast_.data.pop();
+        n_own_pending_for_delivery_.fetch_add(1);
+        own_pending_for_broadcast_.mutex.unlock();
 
-                delivered_.mutex.lock_shared();
-                bool not_delivered = !delivered_.data.Contains(id);
-                delivered_.mutex.unlock_shared();
+        SendInternal({{queued.seq, id_}, id_, PacketView(std::string_view(queued.payload.data(), queued.payload.size()))});
+    }
+}
 
-                if (majority_seen && not_delivered)
-                {
-                    pending_for_delivery_.mutex.lock();
-                    pending_for_delivery_.data.erase(id);
-                    pending_for_delivery_.mutex.unlock();
-
-                    if (id.author == id_ && n_own_pending_for_delivery_.fetch_add(static_cast<unsigned int>(-1)) <= n_own_pending_delivery_ideal_.load())
-                    {
-                        own_pending_for_broadcast_.mutex.lock();
-                        bool pending_for_broadcast_not_empty = !own_pending_for_broadcast_.data.empty();
-                        auto &msg = own_pending_for_broadcast_.data.front();
-                        if (pending_for_broadcast_not_empty)
-                        {
-                            own_pending_for_broadcast_.data.pop();
-                        }
-                        own_pending_for_broadcast_.mutex.unlock();
-
-                        if (pending_for_broadcast_not_empty)
-                        {
-                            n_own_pending_for_delivery_.fetch_add(1);
-                            SendInternal(msg);
-                        }
-                    }
-
-                    delivered_.mutex.lock();
-                    delivered_.data.Insert(id);
-                    delivered_.mutex.unlock();
-
-                    acks_.mutex.lock();
-                    acks_.data.erase(id);
-                    acks_.mutex.unlock();
+void UniformReliableBroadcast::QueueDigestAck(const Broadcast::Message &msg) noexcept
+{
+    digest_pending_.mutex.lock();
+    digest_pending_.data.push_back(msg.id);
+    digest_pending_.mutex.unlock();
+
+    char buffer[PerfectLink::kMaxPayloadSize];
+    std::size_t len = Serialize(msg, buffer);
+
+    relay_payloads_.mutex.lock();
+    relay_payloads_.data.emplace(msg.id, SharedPayload(buffer, len));
+    relay_payloads_.mutex.unlock();
+
+    relay_checks_.mutex.lock();
+    relay_checks_.data.Schedule(ToKey(msg.id), TimerWheel::Clock::now() + std::chrono::milliseconds(URB_DIGEST_RELAY_AFTER_MS));
+    relay_checks_.mutex.unlock();
+
+    // The digest goes out on the next tick, which an idle reactor would not run
+    Wake();
+}
+
+void UniformReliableBroadcast::NotifyDigest(const Broadcast::Message &digest) noexcept
+{
+    if (digest.payload.size() != std::size_t{digest.id.seq} * kDigestRangeSize)
+    {
 #ifdef DEBUG
-                    std::cout << "[DBUG] URB Delivering: " << id.author << " " << id.seq << "\n";
+        std::cout << "Invalid URB Digest received." << std::endl;
 #endif
-                    DeliverInternal(id, true);
+        return;
+    }
+
+    std::vector<Message::Id> majority;
+    for (auto range = digest.payload.begin(); range != digest.payload.end(); range += kDigestRangeSize)
+    {
+        PerfectLink::Id author;
+        Message::Id::Seq first;
+        Message::Id::Seq count;
+        std::memcpy(&author, range, sizeof(author));
+        std::memcpy(&first, range + sizeof(author), sizeof(first));
+        std::memcpy(&count, range + sizeof(author) + sizeof(first), sizeof(count));
+
+        if (author == kDigestAuthor || first == 0)
+        {
+            continue;
+        }
+
+        // A sender never has more of one author's messages in flight than its window allows,
+        // a longer range is malformed and would hold this thread for up to 2^32 acks
+        count = std::min({count, Message::Id::Seq{URB_MAX_MSGS_IN_NETWORK}, std::numeric_limits<Message::Id::Seq>::max() - first + 1});
+
+        // Locked once per range, delivered before acks as everywhere else
+        majority.clear();
+        delivered_.mutex.lock_shared();
+        if (!delivered_.data.Knows(author))
+        {
+            delivered_.mutex.unlock_shared();
+            continue;
+        }
+        acks_.mutex.lock();
+        for (Message::Id::Seq i = 0; i < count; i++)
+        {
+            const Message::Id id{first + i, author};
+            bool delivered = delivered_.data.Contains(id);
+
+            // Acks of a delivered message still matter to its relay, while it has one pending
+            if (!delivered || acks_.data.Contains(id))
+            {
+                auto n_acks = acks_.data.Ack(id, digest.sender);
+                if (!delivered && MajorityAcked(n_acks))
+                {
+                    majority.push_back(id);
                 }
             }
+        }
+        acks_.mutex.unlock();
+        delivered_.mutex.unlock_shared();
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(kFinishDeliveringAllMs));
+        // Only delivers if this process has the message
+        for (const auto &id : majority)
+        {
+            Deliver(id);
         }
-    }
\ No newline at end of file
+    }
+}
+
+void UniformReliableBroadcast::SendDigests() noexcept
+{
+    std::vector<Message::Id> ids;
+
+    digest_pending_.mutex.lock();
+    ids.swap(digest_pending_.data);
+    digest_pending_.mutex.unlock();
+
+    std::sort(ids.begin(), ids.end(), [](const Message::Id &id1, const Message::Id &id2)
+              { return id1.author != id2.author ? id1.author < id2.author : id1.seq < id2.seq; });
+
+    char buffer[PerfectLink::kMaxPayloadSize - kPacketPrefixSize];
+    std::size_t len = 0;
+    Message::Id::Seq n_ranges = 0;
+
+    auto flush = [&]()
+    {
+        BestEffortBroadcast::SendInternal({{n_ranges, kDigestAuthor}, id_, PacketView(std::string_view(buffer, len))});
+        n_digests_.fetch_add(1);
+        len = 0;
+        n_ranges = 0;
+    };
+
+    for (std::size_t begin = 0, end = 0; begin < ids.size(); begin = end)
+    {
+        end = begin + 1;
+        while (end < ids.size() && ids[end].author == ids[begin].author && ids[end].seq == ids[end - 1].seq + 1)
+        {
+            end++;
+        }
+
+        if (len + kDigestRangeSize > sizeof(buffer))
+        {
+            flush();
+        }
+
+        auto count = static_cast<Message::Id::Seq>(end - begin);
+        std::memcpy(buffer + len, &ids[begin].author, sizeof(PerfectLink::Id));
+        std::memcpy(buffer + len + sizeof(PerfectLink::Id), &ids[begin].seq, sizeof(Message::Id::Seq));
+        std::memcpy(buffer + len + sizeof(PerfectLink::Id) + sizeof(Message::Id::Seq), &count, sizeof(count));
+        len += kDigestRangeSize;
+        n_ranges++;
+    }
+
+    if (n_ranges > 0)
+    {
+        flush();
+    }
+}
+
+void UniformReliableBroadcast::RelayUnacked() noexcept
+{
+    std::vector<TimerWheel::Key> due;
+
+    relay_checks_.mutex.lock();
+    relay_checks_.data.Advance(TimerWheel::Clock::now(), due);
+    relay_checks_.mutex.unlock();
+
+    if (due.empty())
+    {
+        return;
+    }
+
+    std::vector<PerfectLink *> pls;
+    perfect_links_.mutex.lock_shared();
+    pls.reserve(perfect_links_.data.end_id());
+    for (const auto &pl : perfect_links_.data)
+    {
+        if (pl != nullptr)
+        {
+            pls.emplace_back(pl.get());
+        }
+    }
+    perfect_links_.mutex.unlock_shared();
+
+    for (const auto key : due)
+    {
+        const auto id = FromKey(key);
+
+        relay_payloads_.mutex.lock();
+        auto it = relay_payloads_.data.find(id);
+        if (it == relay_payloads_.data.end())
+        {
+            relay_payloads_.mutex.unlock();
+            continue;
+        }
+        SharedPayload payload = std::move(it->second);
+        relay_payloads_.data.erase(it);
+        relay_payloads_.mutex.unlock();
+
+        for (const auto pl : pls)
+        {
+            if (pl->target_id() == id.author)
+            {
+                continue;
+            }
+
+            acks_.mutex.lock_shared();
+            bool acked = acks_.data.Contains(id, pl->target_id());
+            acks_.mutex.unlock_shared();
+
+            if (!acked)
+            {
+                pl->Send(payload);
+                n_payload_relays_.fetch_add(1);
+            }
+        }
+
+        // Delivered while the relay was pending, Deliver left the acks for here
+        delivered_.mutex.lock_shared();
+        bool delivered = delivered_.data.Contains(id);
+        delivered_.mutex.unlock_shared();
+
+        if (delivered)
+        {
+            acks_.mutex.lock();
+            acks_.data.Erase(id);
+            acks_.mutex.unlock();
+        }
+    }
+}
+
+void UniformReliableBroadcast::RecordOwnDelivery(Broadcast::Message::Id::Seq seq) noexcept
+{
+    own_sent_at_.mutex.lock();
+    auto sent_at = own_sent_at_.data.find(seq);
+    if (sent_at == own_sent_at_.data.end())
+    {
+        own_sent_at_.mutex.unlock();
+        return;
+    }
+    auto now = TimerWheel::Clock::now();
+    auto latency = now - sent_at->second;
+    own_sent_at_.data.erase(sent_at);
+
+    own_window_.OnCompletion(latency, n_own_pending_for_delivery_.load(), now);
+    n_own_pending_delivery_ideal_.store(own_window_.window());
+    own_base_delay_us_.store(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(own_window_.base_delay()).count()));
+    own_sent_at_.mutex.unlock();
+
+    n_own_delivered_.fetch_add(1);
+    own_latency_us_.fetch_add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count()));
+}
+
+void UniformReliableBroadcast::ScheduleDeliveryCheck(const Broadcast::Message::Id &id) noexcept
+{
+    delivery_checks_.mutex.lock();
+    delivery_checks_.data.Schedule(ToKey(id), TimerWheel::Clock::now());
+    delivery_checks_.mutex.unlock();
+
+    Wake();
+}
@@ -0,0 +1,408 @@
+#include "uring_transport.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+
+UringTransport::UringTransport(UDPServer &server)
+    : server_(server),
+      ring_(kEntries),
+      recv_buffers_(kRecvBuffers * kRecvBufferSize),
+      send_buffers_(kSendSlots * UDPServer::kMaxSendSize),
+      send_addrs_(kSendSlots)
+{
+    int sockfd = server_.sockfd();
+    if (ring_.RegisterFiles(&sockfd, 1) < 0)
+    {
+        throw std::runtime_error("Cannot register socket with io_uring.");
+    }
+
+    void *mem = mmap(nullptr, kRecvBuffers * sizeof(io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+        throw std::runtime_error("Cannot allocate io_uring buffer ring.");
+    }
+
+    // Not io_uring_buf_ring::bufs, in C++ the header's flex array lands past the
+    // tail instead of on top of it. The entries start at offset 0 and the tail
+    // overlays the first entry's resv, which io_uring_buf_ring::tail does get right.
+    buf_ring_ = static_cast<io_uring_buf *>(mem);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<std::uint64_t>(mem);
+    reg.ring_entries = kRecvBuffers;
+    reg.bgid = 0;
+    if (ring_.RegisterBufRing(reg) < 0)
+    {
+        munmap(buf_ring_, kRecvBuffers * sizeof(io_uring_buf));
+        throw std::runtime_error("Cannot register io_uring buffer ring.");
+    }
+
+    for (unsigned int bid = 0; bid < kRecvBuffers; ++bid)
+    {
+        RecycleBuffer(static_cast<std::uint16_t>(bid));
+    }
+    PublishBuffers();
+
+    // Without registered buffers zerocopy would pin pages on every send
+    iovec send_region = {send_buffers_.data(), send_buffers_.size()};
+    if (zerocopy_ && ring_.RegisterBuffers(&send_region, 1) < 0)
+    {
+        zerocopy_ = false;
+    }
+
+    free_slots_.reserve(kSendSlots);
+    for (std::size_t slot = kSendSlots; slot > 0; --slot)
+    {
+        free_slots_.push_back(slot - 1);
+    }
+
+    recv_msg_.msg_namelen = sizeof(sockaddr_in);
+
+    try
+    {
+        Probe();
+    }
+    catch (const std::exception &)
+    {
+        munmap(buf_ring_, kRecvBuffers * sizeof(io_uring_buf));
+        throw;
+    }
+}
+
+UringTransport::~UringTransport() noexcept
+{
+    munmap(buf_ring_, kRecvBuffers * sizeof(io_uring_buf));
+}
+
+void UringTransport::Start(Reactor &reactor)
+{
+    reactor_ = &reactor;
+    server_.BuildDispatch();
+    reactor.Watch(ring_.fd(), this);
+    reactor.AddTicker(this);
+
+    // The receive was armed by Probe, dispatch whatever it got since and re-arm it if it ended
+    Reap();
+}
+
+bool UringTransport::Queue(const char *bytes, std::size_t len, sockaddr_in to_addr) noexcept
+{
+    if (free_slots_.empty() && !WaitForSlot())
+    {
+        n_send_failures_++;
+        return false;
+    }
+
+    io_uring_sqe *sqe = GetSqe();
+    if (sqe == nullptr)
+    {
+        n_send_failures_++;
+        return false;
+    }
+
+    std::size_t slot = free_slots_.back();
+    free_slots_.pop_back();
+
+    char *buffer = send_buffers_.data() + slot * UDPServer::kMaxSendSize;
+    std::memcpy(buffer, bytes, len);
+    send_addrs_[slot] = to_addr;
+
+    sqe->opcode = zerocopy_ ? IORING_OP_SEND_ZC : IORING_OP_SEND;
+    sqe->fd = 0;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->addr = reinterpret_cast<std::uint64_t>(buffer);
+    sqe->len = static_cast<std::uint32_t>(len);
+    sqe->addr2 = reinterpret_cast<std::uint64_t>(&send_addrs_[slot]);
+    sqe->addr_len = sizeof(sockaddr_in);
+    sqe->user_data = (slot << 1) | kSendTag;
+    if (zerocopy_)
+    {
+        sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+        sqe->buf_index = 0;
+    }
+
+    return true;
+}
+
+void UringTransport::Submit() noexcept
+{
+    [[maybe_unused]] int res = ring_.Submit();
+}
+
+void UringTransport::OnReadable() noexcept
+{
+    Reap();
+}
+
+bool UringTransport::OnTick() noexcept
+{
+    if (!deferred_.empty())
+    {
+        Reap();
+    }
+
+    return false;
+}
+
+void UringTransport::ArmRecv() noexcept
+{
+    io_uring_sqe *sqe = GetSqe();
+    if (sqe == nullptr)
+    {
+        return;
+    }
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = 0;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->addr = reinterpret_cast<std::uint64_t>(&recv_msg_);
+    sqe->len = 1;
+    sqe->buf_group = 0;
+    sqe->user_data = kRecvTag;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+
+    recv_armed_ = true;
+}
+
+void UringTransport::Probe()
+{
+    sockaddr_in self{};
+    socklen_t self_len = sizeof(self);
+    if (getsockname(server_.sockfd(), reinterpret_cast<sockaddr *>(&self), &self_len) < 0)
+    {
+        throw std::runtime_error("Cannot get the socket's address.");
+    }
+    if (self.sin_addr.s_addr == htonl(INADDR_ANY))
+    {
+        self.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+
+    // Unsupported flags or fields fail when the sqe is prepared, so
+    // both answers are in by the time the send completes. The empty
+    // datagram is harmless if the kernel is fine with both.
+    ArmRecv();
+    const char empty = 0;
+    if (!Queue(&empty, 0, self))
+    {
+        throw std::runtime_error("Cannot queue an io_uring send.");
+    }
+
+    int send_res = 0;
+    bool recv_supported = true;
+    bool sent = false;
+    while (true)
+    {
+        io_uring_cqe *cqe = ring_.PeekCqe();
+        if (cqe == nullptr)
+        {
+            if (sent)
+            {
+                break;
+            }
+            if (ring_.Submit(1) < 0)
+            {
+                throw std::runtime_error("Cannot submit to io_uring.");
+            }
+            continue;
+        }
+
+        const io_uring_cqe copy = *cqe;
+        ring_.SeenCqe();
+
+        if ((copy.user_data & 1) == kSendTag)
+        {
+            send_res = copy.res;
+            HandleSend(copy);
+            sent = true;
+        }
+        else
+        {
+            recv_supported = recv_supported && copy.res != -EINVAL;
+            if (!(copy.flags & IORING_CQE_F_MORE))
+            {
+                recv_armed_ = false;
+            }
+            // Not dispatched yet, nothing is listening before Start
+            if (copy.flags & IORING_CQE_F_BUFFER)
+            {
+                RecycleBuffer(static_cast<std::uint16_t>(copy.flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+        }
+    }
+    PublishBuffers();
+
+    if (!recv_supported)
+    {
+        throw std::runtime_error("io_uring has no multishot recvmsg.");
+    }
+    if (send_res == -EINVAL)
+    {
+        throw std::runtime_error("io_uring cannot send to an address.");
+    }
+}
+
+io_uring_sqe *UringTransport::GetSqe() noexcept
+{
+    io_uring_sqe *sqe = ring_.GetSqe();
+    if (sqe == nullptr)
+    {
+        // The submission queue is full, make room by handing it to the kernel
+        Submit();
+        sqe = ring_.GetSqe();
+    }
+
+    return sqe;
+}
+
+bool UringTransport::WaitForSlot() noexcept
+{
+    while (free_slots_.empty())
+    {
+        io_uring_cqe *cqe = ring_.PeekCqe();
+        if (cqe == nullptr)
+        {
+            if (ring_.Submit(1) < 0)
+            {
+                return false;
+            }
+            continue;
+        }
+
+        if ((cqe->user_data & 1) == kSendTag)
+        {
+            HandleSend(*cqe);
+        }
+        else
+        {
+            // Delivering from here could re-enter the caller, which may hold locks
+            deferred_.push_back(*cqe);
+        }
+        ring_.SeenCqe();
+    }
+
+    if (!deferred_.empty() && reactor_ != nullptr)
+    {
+        reactor_->Wake();
+    }
+
+    return true;
+}
+
+void UringTransport::Reap() noexcept
+{
+    std::size_t n_received = 0;
+
+    for (const auto &cqe : deferred_)
+    {
+        HandleRecv(cqe);
+        n_received++;
+    }
+    deferred_.clear();
+
+    while (io_uring_cqe *cqe = ring_.PeekCqe())
+    {
+        const io_uring_cqe copy = *cqe;
+        ring_.SeenCqe();
+
+        if ((copy.user_data & 1) == kSendTag)
+        {
+            HandleSend(copy);
+        }
+        else
+        {
+            HandleRecv(copy);
+            n_received++;
+        }
+    }
+
+    PublishBuffers();
+
+    if (!recv_armed_)
+    {
+        ArmRecv();
+        Submit();
+    }
+
+    if (n_received > 0)
+    {
+        server_.shards_.front()->n_receive_calls.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void UringTransport::HandleRecv(const io_uring_cqe &cqe) noexcept
+{
+    if (!(cqe.flags & IORING_CQE_F_MORE))
+    {
+        recv_armed_ = false;
+    }
+
+    // Probe made sure multishot receives are supported, an error only ends this one
+    if (cqe.res < 0)
+    {
+        return;
+    }
+
+    if (!(cqe.flags & IORING_CQE_F_BUFFER))
+    {
+        return;
+    }
+
+    auto bid = static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    const char *buffer = recv_buffers_.data() + bid * kRecvBufferSize;
+
+    io_uring_recvmsg_out out;
+    std::memcpy(&out, buffer, sizeof(out));
+
+    if (out.namelen >= sizeof(sockaddr_in) && !(out.flags & MSG_TRUNC))
+    {
+        sockaddr_in addr;
+        std::memcpy(&addr, buffer + sizeof(out), sizeof(addr));
+
+        // Viewed in place, the buffer goes back to the kernel right after
+        const char *payload = buffer + sizeof(out) + recv_msg_.msg_namelen + recv_msg_.msg_controllen;
+
+        server_.shards_.front()->n_packets_received.fetch_add(1, std::memory_order_relaxed);
+        server_.NotifyAll(PacketView(std::string_view(payload, out.payloadlen)), addr);
+    }
+
+    RecycleBuffer(bid);
+}
+
+void UringTransport::HandleSend(const io_uring_cqe &cqe) noexcept
+{
+    if (cqe.res < 0 && !(cqe.flags & IORING_CQE_F_NOTIF))
+    {
+        n_send_failures_++;
+
+        if ((cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) && zerocopy_)
+        {
+            zerocopy_ = false;
+        }
+    }
+
+    // A zerocopy send owns its slot until the notification
+    // that the kernel is done with the buffer
+    if (cqe.flags & IORING_CQE_F_MORE)
+    {
+        return;
+    }
+
+    free_slots_.push_back(cqe.user_data >> 1);
+}
+
+void UringTransport::RecycleBuffer(std::uint16_t bid) noexcept
+{
+    io_uring_buf &buf = buf_ring_[buf_tail_ & (kRecvBuffers - 1)];
+    buf.addr = reinterpret_cast<std::uint64_t>(recv_buffers_.data() + bid * kRecvBufferSize);
+    buf.len = static_cast<std::uint32_t>(kRecvBufferSize);
+    buf.bid = bid;
+    buf_tail_++;
+}
+
+void UringTransport::PublishBuffers() noexcept
+{
+    auto *ring = reinterpret_cast<io_uring_buf_ring *>(buf_ring_);
+    __atomic_store_n(&ring->tail, buf_tail_, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+
+import argparse
+import os
+import re
+import shlex
+import signal
+import subprocess
+import time
+
+PROCESSES_BASE_IP = 11000
+
+def generateConfig(directory, testType, processes, messages):
+    hostsfile = os.path.join(directory, 'hosts')
+    configfile = os.path.join(directory, 'config')
+
+    with open(hostsfile, 'w') as hosts:
+        for i in range(1, processes + 1):
+            hosts.write("{} localhost {}\n".format(i, PROCESSES_BASE_IP+i))
+
+    with open(configfile, 'w') as config:
+        if testType == "perfect":
+            config.write("{} 1\n".format(messages))
+        else:
+            config.write("{}\n".format(messages))
+
+    return (hostsfile, configfile)
+
+def runVariant(binary, testType, processes, messages, duration, logsDir, extraArgs):
+    hostsFile, configFile = generateConfig(logsDir, testType, processes, messages)
+
+    procs = []
+    for pid in range(1, processes + 1):
+        cmd = [binary,
+               '--id', str(pid),
+               '--hosts', hostsFile,
+               '--output', os.path.join(logsDir, 'proc{:02d}.output'.format(pid)),
+               configFile]
+
+        if testType == "perfect":
+            cmd += ['--mode', 'pl']
+
+        cmd += extraArgs
+
+        stdoutFd = open(os.path.join(logsDir, 'proc{:02d}.stdout'.format(pid)), "w")
+        stderrFd = open(os.path.join(logsDir, 'proc{:02d}.stderr'.format(pid)), "w")
+        procs.append(subprocess.Popen(cmd, stdout=stdoutFd, stderr=stderrFd))
+
+    time.sleep(duration)
+
+    for p in procs:
+        p.send_signal(signal.SIGTERM)
+
+    for p in procs:
+        p.wait()
+
+    delivered = 0
+    stats = {}
+    for pid in range(1, processes + 1):
+        with open(os.path.join(logsDir, 'proc{:02d}.output'.format(pid))) as f:
+            delivered += sum(1 for line in f if line.startswith('d'))
+
+        # Every `[INFO] key = value` line of the stats printed on stop is summed across processes
+        with open(os.path.join(logsDir, 'proc{:02d}.stdout'.format(pid))) as f:
+            inStats = False
+            for line in f:
+                inStats = inStats or " Stats" in line
+                m = re.match(r"\[INFO\] ([a-z_]+) = (-?[0-9]+(\.[0-9]+)?([eE][+-]?[0-9]+)?)$", line.strip())
+                if inStats and m:
+                    stats[m.group(1)] = stats.get(m.group(1), 0.0) + float(m.group(2))
+
+    # Ratios are averaged across processes, counters and rates are summed
+    for key in stats:
+        if "_per_" in key and not key.endswith("_per_sec"):
+            stats[key] /= processes
+
+    return delivered, stats
+
+def main(results):
+    binary = os.path.abspath(results.binary)
+    if not os.path.isfile(binary):
+        raise Exception("`{}` is not a file".format(binary))
+
+    if not os.path.isdir(results.logsDir):
+        raise ValueError('Directory `{}` does not exist'.format(results.logsDir))
+
+    variants = results.variants if results.variants else [""]
+
+    rows = []
+    for variant in variants:
+        variantDir = os.path.join(results.logsDir, re.sub(r"[^A-Za-z0-9]+", "_", variant).strip("_") or "default")
+        os.makedirs(variantDir, exist_ok=True)
+
+        delivered, stats = runVariant(binary, results.testType, results.processes, results.messages,
+                                      results.duration, variantDir, shlex.split(variant))
+        rows.append((variant or "(default)", delivered, stats))
+
+    for variant, delivered, stats in rows:
+        print("Variant: {}".format(variant))
+        print("  delivered = {}".format(delivered))
+        print("  delivered_per_sec = {:.1f}".format(delivered / results.duration))
+        for key in sorted(stats):
+            print("  {} = {:.2f}".format(key, stats[key]))
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Runs every variant for a fixed duration and compares throughput")
+
+    parser.add_argument(
+        "-b",
+        "--binary",
+        required=True,
+        dest="binary",
+        help="Path to da_proc",
+    )
+
+    parser.add_argument(
+        "-t",
+        "--test",
+        choices=["perfect", "fifo"],
+        required=True,
+        dest="testType",
+        help="Which test to run",
+    )
+
+    parser.add_argument(
+        "-l",
+        "--logs",
+        required=True,
+        dest="logsDir",
+        help="Directory to store stdout, stderr and outputs generated by the processes",
+    )
+
+    parser.add_argument(
+        "-p",
+        "--processes",
+        required=True,
+        type=int,
+        dest="processes",
+        help="Number of processes",
+    )
+
+    parser.add_argument(
+        "-m",
+        "--messages",
+        required=True,
+        type=int,
+        dest="messages",
+        help="Number of messages each process sends",
+    )
+
+    parser.add_argument(
+        "-d",
+        "--duration",
+        default=10.0,
+        type=float,
+        dest="duration",
+        help="Seconds to run each variant before sending SIGTERM",
+    )
+
+    parser.add_argument(
+        "variants",
+        nargs="*",
+        help="Extra arguments for da_proc, one quoted string per variant (e.g. \"--recv-batch 1\" \"--recv-batch 64\")",
+    )
+
+    main(parser.parse_args())